@@ -0,0 +1,352 @@
+#include "benchmark.h"
+#include "../MemoryManagement/block_pool.h"
+#include "../MemoryManagement/pool_allocator.h"
+#include "../MemoryManagement/static_pool_allocator.h"
+
+#include <map>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <typeinfo>
+#include <algorithm>
+#include <typeindex>
+#include <unordered_map>
+#include <memory_resource>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+Allocators against each other at several element sizes:
+- churn: allocate/free of a working set in LIFO, FIFO and random order
+  (the only case for StaticPoolAllocator, whose capacity is fixed);
+- node containers: std::list, std::map and std::unordered_map filled
+  and drained with every allocator;
+- traversal: iterating a container after it has been churned, i.e.
+  the price of the node layout the allocator has left behind;
+- memory: peak RSS growth while a large container is built (measured
+  in a child process)
+*********************************************************************/
+namespace {
+	constexpr size_t WORKING_SET{ 4096 },
+		CONTAINER_SIZE{ 1 << 16 },
+		MEMORY_CONTAINER_SIZE{ 1 << 20 };
+
+	template <size_t size>
+	struct payload {
+		unsigned char data[size];
+	};
+
+	template <template <class> class Pool>
+	class pool_set {															//One pool per element type, created on first use
+	public:
+		template <class Ty>
+		Pool<Ty>& get() {
+			shared_ptr<void>& pool{ m_pools[type_index{ typeid(Ty) }] };
+			if (!pool) {
+				pool = make_shared<Pool<Ty>>();
+			}
+			return *static_cast<Pool<Ty>*>(pool.get());
+		}
+	private:
+		unordered_map<type_index, shared_ptr<void>> m_pools;
+	};
+
+	template <class Ty, template <class> class Pool>
+	class shared_pool_allocator {												//The pool allocators can't be copied, so a container's copies (rebound
+	public:																		//ones too) share a pool_set and compare equal; arrays (e.g. hash
+		using value_type = Ty;													//buckets) come from std::allocator
+
+		template <class OtherTy>
+		struct rebind {
+			using other = shared_pool_allocator<OtherTy, Pool>;
+		};
+	public:
+		explicit shared_pool_allocator(shared_ptr<pool_set<Pool>> pools)
+			: m_pools{ move(pools) }, m_pool{ &m_pools->template get<Ty>() }
+		{
+		}
+		template <class OtherTy>
+		shared_pool_allocator(const shared_pool_allocator<OtherTy, Pool>& other)
+			: shared_pool_allocator(other.m_pools)
+		{
+		}
+
+		template <class OtherTy>
+		bool operator==(const shared_pool_allocator<OtherTy, Pool>& other) const noexcept {
+			return m_pools == other.m_pools;
+		}
+		template <class OtherTy>
+		bool operator!=(const shared_pool_allocator<OtherTy, Pool>& other) const noexcept {
+			return !(*this == other);
+		}
+	public:
+		Ty* allocate(size_t count) {
+			return count == 1 ? m_pool->allocate(1) : allocator<Ty>{}.allocate(count);
+		}
+		void deallocate(Ty* ptr, size_t count) noexcept {
+			if (count == 1) {
+				m_pool->deallocate(ptr, 1);
+			}
+			else {
+				allocator<Ty>{}.deallocate(ptr, count);
+			}
+		}
+	private:
+		template <class OtherTy, template <class> class OtherPool>
+		friend class shared_pool_allocator;
+	private:
+		shared_ptr<pool_set<Pool>> m_pools;
+		Pool<Ty>* m_pool;														//Cached: no lookup per allocation
+	};
+
+	template <class Ty>
+	using static_pool_allocator = memory::StaticPoolAllocator<Ty, WORKING_SET>;	//Holds exactly the churn working set
+
+	/*********************************************************************
+	Every case gets a fresh allocator kind: make<Ty>() returns an allocator
+	bound to the resources of this very instance
+	*********************************************************************/
+	struct std_allocator_kind {
+		static constexpr const char* NAME{ "std::allocator" };
+
+		template <class Ty>
+		allocator<Ty> make() const noexcept {
+			return {};
+		}
+	};
+
+	template <template <class> class Pool>
+	struct pool_kind {
+		static constexpr const char* NAME{ is_same_v<Pool<char>, memory::PoolAllocator<char>> ? "PoolAllocator" : "StaticPoolAllocator" };
+
+		template <class Ty>
+		shared_pool_allocator<Ty, Pool> make() const {
+			return shared_pool_allocator<Ty, Pool>{ pools };
+		}
+
+		shared_ptr<pool_set<Pool>> pools{ make_shared<pool_set<Pool>>() };
+	};
+
+	struct block_pool_allocator_kind {
+		static constexpr const char* NAME{ "BlockPoolAllocator" };
+
+		template <class Ty>
+		memory::BlockPoolAllocator<Ty> make() const noexcept {
+			return memory::BlockPoolAllocator<Ty>{ pool };
+		}
+
+		shared_ptr<memory::BlockPool> pool{ make_shared<memory::BlockPool>() };
+	};
+
+	template <class Resource>
+	struct pmr_kind {
+		static constexpr const char* NAME{ is_same_v<Resource, pmr::synchronized_pool_resource> ? "pmr::synchronized_pool" : "pmr::unsynchronized_pool" };
+
+		template <class Ty>
+		pmr::polymorphic_allocator<Ty> make() const noexcept {
+			return pmr::polymorphic_allocator<Ty>{ resource.get() };
+		}
+
+		unique_ptr<Resource> resource{ make_unique<Resource>() };
+	};
+
+	template <class Allocator>
+	class churn {																//A working set of blocks freed and allocated again in various orders
+	public:
+		using traits = allocator_traits<Allocator>;
+		using pointer = typename traits::pointer;
+	public:
+		explicit churn(Allocator alloc)
+			: m_alloc(move(alloc)), m_blocks(WORKING_SET)
+		{
+		}
+	public:
+		void lifo(size_t operations) {
+			for (size_t done = 0; done < operations; done += 2 * WORKING_SET) {
+				allocate_all();
+				for (size_t idx = WORKING_SET; idx > 0; --idx) {
+					traits::deallocate(m_alloc, m_blocks[idx - 1], 1);
+				}
+			}
+		}
+		void fifo(size_t operations) {
+			for (size_t done = 0; done < operations; done += 2 * WORKING_SET) {
+				allocate_all();
+				for (size_t idx = 0; idx < WORKING_SET; ++idx) {
+					traits::deallocate(m_alloc, m_blocks[idx], 1);
+				}
+			}
+		}
+		void random(size_t operations) {										//Every operation frees a random block and allocates a new one
+			allocate_all();
+			uint64_t state{ 42 };
+			for (size_t done = 0; done < operations; done += 2) {
+				state = state * 6364136223846793005ull + 1442695040888963407ull;
+				pointer& block{ m_blocks[(state >> 32) % WORKING_SET] };
+				traits::deallocate(m_alloc, block, 1);
+				block = traits::allocate(m_alloc, 1);
+				benchmark::do_not_optimize(block);
+			}
+			for (const pointer block : m_blocks) {
+				traits::deallocate(m_alloc, block, 1);
+			}
+		}
+	private:
+		void allocate_all() {
+			for (pointer& block : m_blocks) {
+				block = traits::allocate(m_alloc, 1);
+				benchmark::do_not_optimize(block);
+			}
+		}
+	private:
+		Allocator m_alloc;
+		vector<pointer> m_blocks;
+	};
+
+	template <class Kind, class Ty>
+	using allocator_for = decltype(declval<const Kind&>().template make<Ty>());
+
+	template <class Kind, size_t size>
+	void run_churn(benchmark::runner& runner) {
+		using workload_type = churn<allocator_for<Kind, payload<size>>>;
+
+		const string suffix{ string{ "/" } + Kind::NAME + "/" + to_string(size) + "B" };
+		for (const auto& [pattern, method] : {
+			pair{ "churn/lifo", &workload_type::lifo },
+			pair{ "churn/fifo", &workload_type::fifo },
+			pair{ "churn/random", &workload_type::random } })
+		{
+			Kind kind;
+			workload_type workload{ kind.template make<payload<size>>() };
+			runner.run(pattern + suffix, [&workload, method = method](size_t operations) {
+				(workload.*method)(operations);
+			});
+		}
+	}
+
+	template <class Container>
+	struct is_list
+		: false_type {};
+
+	template <class Ty, class Allocator>
+	struct is_list<list<Ty, Allocator>>
+		: true_type {};
+
+	template <class Container>
+	void fill(Container& cont, size_t count) {
+		if constexpr (is_list<Container>::value) {
+			while (cont.size() < count) {
+				cont.emplace_back();
+			}
+		}
+		else {
+			uint64_t state{ 7 };
+			while (cont.size() < count) {
+				state = state * 6364136223846793005ull + 1442695040888963407ull;
+				cont.try_emplace(state >> 16);
+			}
+		}
+	}
+
+	template <class Container>
+	void churn_container(Container& cont) {										//Replaces every other element: the survivors and the new nodes interleave
+		const size_t count{ cont.size() };
+		for (auto it = cont.begin(); it != cont.end();) {
+			it = cont.erase(it);
+			if (it != cont.end()) {
+				++it;
+			}
+		}
+		fill(cont, count);
+	}
+
+	template <class Container>
+	size_t traverse(const Container& cont, size_t operations) {
+		size_t sum{ 0 },
+			done{ 0 };
+		while (done < operations) {
+			for (const auto& value : cont) {
+				if constexpr (is_list<Container>::value) {
+					sum += value.data[0];
+				}
+				else {
+					sum += value.second.data[0];
+				}
+				if (++done == operations) {
+					break;
+				}
+			}
+		}
+		return sum;
+	}
+
+	template <class Kind, size_t size, class Container>
+	void run_container(benchmark::runner& runner, const char* container_name) {
+		using value_type = typename Container::value_type;
+
+		const string suffix{ string{ "/" } + container_name + "/" + Kind::NAME + "/" + to_string(size) + "B" };
+		{
+			Kind kind;
+			runner.run("fill+clear" + suffix, [&kind](size_t operations) {		//Operations: insertions
+				for (size_t done = 0; done < operations; done += CONTAINER_SIZE) {
+					Container cont(kind.template make<value_type>());
+					fill(cont, (min)(CONTAINER_SIZE, operations - done));
+					benchmark::do_not_optimize(cont.size());
+				}
+			});
+		}
+		{
+			Kind kind;
+			Container cont(kind.template make<value_type>());
+			fill(cont, CONTAINER_SIZE);
+			churn_container(cont);
+			runner.run("traverse-after-churn" + suffix, [&cont](size_t operations) {	//Operations: visited elements
+				benchmark::do_not_optimize(traverse(cont, operations));
+			});
+		}
+		if (const string name{ "memory" + suffix }; runner.selected(name)) {
+			const auto growth{ benchmark::isolated_peak_rss([] {
+				Kind kind;
+				Container cont(kind.template make<value_type>());
+				fill(cont, MEMORY_CONTAINER_SIZE);
+				benchmark::do_not_optimize(cont.size());
+			}) };
+			runner.note(name, growth
+				? "peak RSS +" + to_string(*growth / 1024) + " KiB, " + to_string(*growth / MEMORY_CONTAINER_SIZE) + " B per element"
+				: string{ "peak RSS unavailable on this platform" });
+		}
+	}
+
+	template <class Kind, size_t size>
+	void run_all(benchmark::runner& runner) {
+		using map_value = pair<const uint64_t, payload<size>>;
+
+		run_churn<Kind, size>(runner);
+		run_container<Kind, size, list<payload<size>, allocator_for<Kind, payload<size>>>>(runner, "list");
+		run_container<Kind, size, map<uint64_t, payload<size>, less<uint64_t>, allocator_for<Kind, map_value>>>(runner, "map");
+		run_container<Kind, size, unordered_map<uint64_t, payload<size>, hash<uint64_t>, equal_to<uint64_t>, allocator_for<Kind, map_value>>>(runner, "unordered_map");
+	}
+
+	template <size_t size>
+	void run_size(benchmark::runner& runner) {
+		run_all<std_allocator_kind, size>(runner);
+		run_all<pool_kind<memory::PoolAllocator>, size>(runner);
+		run_churn<pool_kind<static_pool_allocator>, size>(runner);				//A fixed capacity: too small for the containers
+		run_all<block_pool_allocator_kind, size>(runner);
+		run_all<pmr_kind<pmr::unsynchronized_pool_resource>, size>(runner);
+		run_all<pmr_kind<pmr::synchronized_pool_resource>, size>(runner);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	benchmark::runner runner{ benchmark::parse_options(argc, argv) };
+	run_size<16>(runner);
+	run_size<64>(runner);
+	run_size<256>(runner);
+	runner.note("process", "peak RSS " + to_string(benchmark::peak_rss() / (1024 * 1024)) + " MiB");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,291 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <optional>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#define UTILITY_BENCHMARK_POSIX
+#endif
+
+/*********************************************************************
+Minimal benchmark harness: a case is a callable performing the given
+number of operations; the harness grows the count until a run takes
+at least --min-time, repeats the run --repetitions times and reports
+the median. Multithreaded cases start all threads at once and are
+timed by the wall clock of the slowest one. Memory usage is read from
+the OS (RSS), so it is only reported where the OS exposes it
+*********************************************************************/
+namespace utility::benchmark {
+	using clock = std::chrono::steady_clock;
+
+	struct options {
+		double min_time{ 0.2 };													//Seconds per repetition
+		size_t repetitions{ 3 },
+			max_threads{ 64 };
+		std::string filter;														//Substring of the case name
+	};
+
+	template <class Extra>
+	options parse_options(int argc, char* argv[], Extra&& extra, const char* extra_usage = "") {	//extra(arg) handles benchmark-specific arguments
+		options opts;
+		for (int idx = 1; idx < argc; ++idx) {
+			const char* arg{ argv[idx] };
+			auto value_of = [arg](const char* name) -> const char* {
+				const size_t length{ std::strlen(name) };
+				return std::strncmp(arg, name, length) == 0 && arg[length] == '=' ? arg + length + 1 : nullptr;
+			};
+			if (const char* value = value_of("--min-time")) {
+				opts.min_time = std::atof(value);
+			}
+			else if (const char* value = value_of("--repetitions")) {
+				opts.repetitions = (std::max)(static_cast<size_t>(std::atoll(value)), size_t{ 1 });
+			}
+			else if (const char* value = value_of("--max-threads")) {
+				opts.max_threads = (std::max)(static_cast<size_t>(std::atoll(value)), size_t{ 1 });
+			}
+			else if (const char* value = value_of("--filter")) {
+				opts.filter = value;
+			}
+			else if (std::strcmp(arg, "--quick") == 0) {						//A smoke run
+				opts.min_time = 0.01;
+				opts.repetitions = 1;
+			}
+			else if (!extra(std::string{ arg })) {
+				std::fprintf(stderr, "Usage: %s [--min-time=seconds] [--repetitions=N] [--max-threads=N] [--filter=substring] [--quick]%s\n", argv[0], extra_usage);
+				std::exit(EXIT_FAILURE);
+			}
+		}
+		return opts;
+	}
+
+	inline options parse_options(int argc, char* argv[]) {
+		return parse_options(argc, argv, [](const std::string&) { return false; });
+	}
+
+	template <class Ty>
+	inline void do_not_optimize(const Ty& value) {								//Keeps the computation of value alive
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+
+	inline std::vector<size_t> thread_counts(size_t max_threads) {				//1, 2, 4... max_threads
+		std::vector<size_t> counts;
+		for (size_t count = 1; count < max_threads; count <<= 1) {
+			counts.push_back(count);
+		}
+		counts.push_back(max_threads);
+		return counts;
+	}
+
+	inline double percentile(std::vector<double>& samples, double fraction) {	//Partially reorders samples
+		if (samples.empty()) {
+			return 0;
+		}
+		const size_t idx{ (std::min)(static_cast<size_t>(fraction * static_cast<double>(samples.size())), samples.size() - 1) };
+		std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(idx), samples.end());
+		return samples[idx];
+	}
+
+	inline std::string latency_summary(std::vector<double>& samples_ns) {		//Percentiles in microseconds; partially reorders samples
+		char text[160];
+		const auto us = [&samples_ns](double fraction) { return percentile(samples_ns, fraction) / 1000; };
+		std::snprintf(text, sizeof(text), "p50 %.2f us, p90 %.2f us, p99 %.2f us, p999 %.2f us, max %.2f us (%zu samples)",
+			us(0.5), us(0.9), us(0.99), us(0.999), us(1.0), samples_ns.size());
+		return text;
+	}
+
+	inline std::optional<size_t> open_descriptors() {						//Files and sockets of the process
+#ifdef __linux__
+		if (DIR* fds = opendir("/proc/self/fd")) {
+			size_t count{ 0 };
+			while (const dirent* entry = readdir(fds)) {
+				count += entry->d_name[0] != '.';
+			}
+			closedir(fds);
+			return count - 1;													//The descriptor of the directory itself
+		}
+#endif
+		return std::nullopt;
+	}
+
+	inline size_t peak_rss() noexcept {										//Bytes; 0 if unknown
+#ifdef UTILITY_BENCHMARK_POSIX
+		rusage usage{};
+		if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+			return static_cast<size_t>(usage.ru_maxrss);
+#else
+			return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+		}
+#endif
+		return 0;
+	}
+
+	inline size_t current_rss() noexcept {										//Bytes; 0 if unknown
+#ifdef __linux__
+		if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+			unsigned long long size{ 0 }, resident{ 0 };
+			const int parsed{ std::fscanf(statm, "%llu %llu", &size, &resident) };
+			std::fclose(statm);
+			if (parsed == 2) {
+				return static_cast<size_t>(resident * static_cast<unsigned long long>(sysconf(_SC_PAGESIZE)));
+			}
+		}
+#endif
+		return 0;
+	}
+
+	template <class Function>
+	std::optional<size_t> isolated_peak_rss(Function&& func) {					//Runs func() in a child process and returns how much its peak RSS grew
+#if defined(UTILITY_BENCHMARK_POSIX) && defined(__linux__)						//The parent's freed but cached memory doesn't hide the growth
+		int channel[2];
+		if (pipe(channel) != 0) {
+			return std::nullopt;
+		}
+		std::fflush(stdout);
+		const pid_t child{ fork() };
+		if (child == 0) {
+			close(channel[0]);
+			const size_t baseline{ current_rss() };
+			func();
+			const size_t peak{ peak_rss() },
+				growth{ peak > baseline ? peak - baseline : 0 };
+			const bool written{ write(channel[1], &growth, sizeof(growth)) == static_cast<ssize_t>(sizeof(growth)) };
+			_exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		close(channel[1]);
+		size_t growth{ 0 };
+		const bool received{ child > 0 && read(channel[0], &growth, sizeof(growth)) == static_cast<ssize_t>(sizeof(growth)) };
+		close(channel[0]);
+		if (child > 0) {
+			int status;
+			waitpid(child, &status, 0);
+		}
+		return received ? std::optional<size_t>{ growth } : std::nullopt;
+#else
+		(void)func;
+		return std::nullopt;
+#endif
+	}
+
+	class start_gate {															//Releases all threads of a run at once
+	public:
+		explicit start_gate(size_t thread_count) noexcept
+			: m_waiting{ thread_count }
+		{
+		}
+		void arrive_and_wait() noexcept {
+			m_waiting.fetch_sub(1, std::memory_order_acq_rel);
+			while (m_waiting.load(std::memory_order_acquire) != 0) {
+				std::this_thread::yield();
+			}
+		}
+	private:
+		std::atomic<size_t> m_waiting;
+	};
+
+	class runner {
+	public:
+		explicit runner(options opts)
+			: m_options{ std::move(opts) }
+		{
+			std::printf("%-64s %8s %14s %12s %14s\n", "Benchmark", "Threads", "Operations", "ns/op", "Mops/s");
+		}
+	public:
+		const options& settings() const noexcept {
+			return m_options;
+		}
+		bool selected(const std::string& name) const {
+			return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+		}
+
+		template <class Function>
+		std::optional<double> run(const std::string& name, Function&& func) {	//func(size_t operations); returns ns/op unless filtered out
+			return run_threads(name, 1, [&func](size_t, size_t operations) { func(operations); });
+		}
+
+		template <class Function>
+		std::optional<double> run_threads(const std::string& name, size_t thread_count, Function&& func) {	//func(size_t thread_idx, size_t operations), operations per thread
+			return run_threads(name, thread_count, std::forward<Function>(func), [] {});
+		}
+
+		template <class Function, class Completion>
+		std::optional<double> run_threads(const std::string& name, size_t thread_count, Function&& func, Completion&& complete) {	//complete() is timed after the threads finish
+			if (!selected(name)) {																					//(e.g. waits for the submitted work)
+				return std::nullopt;
+			}
+			size_t operations{ 1 };
+			double elapsed{ measure(thread_count, operations, func, complete) };
+			while (elapsed < m_options.min_time && operations < (size_t{ 1 } << 40)) {
+				const double scale{ elapsed > 0 ? m_options.min_time / elapsed * 1.2 : 10.0 };
+				operations = static_cast<size_t>(static_cast<double>(operations) * (std::min)((std::max)(scale, 2.0), 100.0));
+				elapsed = measure(thread_count, operations, func, complete);
+			}
+			std::vector<double> samples{ elapsed };
+			for (size_t rep = 1; rep < m_options.repetitions; ++rep) {
+				samples.push_back(measure(thread_count, operations, func, complete));
+			}
+			const double median{ percentile(samples, 0.5) },
+				total_operations{ static_cast<double>(operations * thread_count) },
+				ns_per_op{ median * 1e9 / total_operations };
+			report(name, thread_count, operations * thread_count, ns_per_op, total_operations / median / 1e6);
+			return ns_per_op;
+		}
+
+		void report(const std::string& name, size_t thread_count, size_t operations, double ns_per_op, double mops_per_sec) const {
+			std::printf("%-64s %8zu %14zu %12.2f %14.3f\n", name.c_str(), thread_count, operations, ns_per_op, mops_per_sec);
+			std::fflush(stdout);
+		}
+		void note(const std::string& name, const std::string& text) const {	//Free-form metrics: latency percentiles, memory usage
+			if (selected(name)) {
+				std::printf("%-64s %s\n", name.c_str(), text.c_str());
+				std::fflush(stdout);
+			}
+		}
+	private:
+		template <class Function, class Completion>
+		static double measure(size_t thread_count, size_t operations, Function& func, Completion& complete) {
+			if (thread_count == 1) {
+				const auto start{ clock::now() };
+				func(size_t{ 0 }, operations);
+				complete();
+				return std::chrono::duration<double>(clock::now() - start).count();
+			}
+			start_gate gate{ thread_count + 1 };
+			std::vector<std::thread> threads;
+			threads.reserve(thread_count);
+			for (size_t idx = 0; idx < thread_count; ++idx) {
+				threads.emplace_back([&gate, &func, idx, operations] {
+					gate.arrive_and_wait();
+					func(idx, operations);
+				});
+			}
+			gate.arrive_and_wait();
+			const auto start{ clock::now() };
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			complete();
+			return std::chrono::duration<double>(clock::now() - start).count();
+		}
+	private:
+		options m_options;
+	};
+}
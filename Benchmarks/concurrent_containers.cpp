@@ -0,0 +1,151 @@
+#include "benchmark.h"
+#include "../Containers/mpmc_queue.h"
+#include "../Containers/concurrent_hash_map.h"
+#include "../MemoryManagement/block_pool.h"
+
+#include <mutex>
+#include <queue>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+Throughput of the concurrent containers against the STL ones behind a
+single mutex. Queue: every thread pushes an element and pops one, so
+the queue is neither full nor empty for long. Map: a prefilled table
+with 90% lookups and 10% updates over a uniformly random key
+*********************************************************************/
+namespace {
+	constexpr size_t QUEUE_CAPACITY{ 1024 },
+		KEY_COUNT{ 1 << 16 };
+
+	template <class Ty>
+	class locked_queue {
+	public:
+		bool try_push(Ty value) {
+			lock_guard lock{ m_mutex };
+			m_queue.push(move(value));
+			return true;
+		}
+		bool try_pop(Ty& value) {
+			lock_guard lock{ m_mutex };
+			if (m_queue.empty()) {
+				return false;
+			}
+			value = move(m_queue.front());
+			m_queue.pop();
+			return true;
+		}
+	private:
+		mutex m_mutex;
+		queue<Ty> m_queue;
+	};
+
+	template <class Key, class Ty>
+	class locked_map {
+	public:
+		void insert_or_assign(const Key& key, const Ty& value) {
+			lock_guard lock{ m_mutex };
+			m_map.insert_or_assign(key, value);
+		}
+		bool contains(const Key& key) const {
+			lock_guard lock{ m_mutex };
+			return m_map.find(key) != m_map.end();
+		}
+	private:
+		mutable mutex m_mutex;
+		unordered_map<Key, Ty> m_map;
+	};
+
+	template <class Queue>
+	void queue_round_trips(Queue& queue, size_t operations) {
+		uint64_t value{ 0 };
+		for (size_t idx = 0; idx < operations; idx += 2) {
+			while (!queue.try_push(uint64_t{ idx })) {
+				this_thread::yield();
+			}
+			while (!queue.try_pop(value)) {
+				this_thread::yield();
+			}
+		}
+		benchmark::do_not_optimize(value);
+	}
+
+	template <class Map>
+	void map_mixed_access(Map& map, size_t thread_idx, size_t operations) {
+		uint64_t state{ thread_idx };
+		size_t found{ 0 };
+		for (size_t idx = 0; idx < operations; ++idx) {
+			state = state * 6364136223846793005ull + 1442695040888963407ull;	//A cheap LCG: the generator mustn't dominate
+			const uint64_t key{ (state >> 32) % KEY_COUNT };
+			if (idx % 10 == 0) {
+				map.insert_or_assign(key, idx);
+			}
+			else {
+				found += map.contains(key);
+			}
+		}
+		benchmark::do_not_optimize(found);
+	}
+
+	template <class Map>
+	void prefill(Map& map) {
+		for (uint64_t key = 0; key < KEY_COUNT; key += 2) {
+			map.insert_or_assign(key, key);
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	benchmark::runner runner{ benchmark::parse_options(argc, argv) };
+	const auto pool{ make_shared<memory::BlockPool>() };
+	for (const size_t threads : benchmark::thread_counts(runner.settings().max_threads)) {
+		{
+			container::mpmc_queue<uint64_t> queue{ QUEUE_CAPACITY };
+			runner.run_threads("queue/mpmc_queue", threads, [&queue](size_t, size_t operations) {
+				queue_round_trips(queue, operations);
+			});
+		}
+		{
+			container::mpmc_queue<uint64_t, memory::BlockPoolAllocator<uint64_t>> queue{
+				QUEUE_CAPACITY, memory::BlockPoolAllocator<uint64_t>{ pool } };
+			runner.run_threads("queue/mpmc_queue<BlockPoolAllocator>", threads, [&queue](size_t, size_t operations) {
+				queue_round_trips(queue, operations);
+			});
+		}
+		{
+			locked_queue<uint64_t> queue;
+			runner.run_threads("queue/mutex+std::queue", threads, [&queue](size_t, size_t operations) {
+				queue_round_trips(queue, operations);
+			});
+		}
+		{
+			container::concurrent_hash_map<uint64_t, size_t> map;
+			prefill(map);
+			runner.run_threads("map/concurrent_hash_map", threads, [&map](size_t thread_idx, size_t operations) {
+				map_mixed_access(map, thread_idx, operations);
+			});
+		}
+		{
+			using allocator_type = memory::BlockPoolAllocator<pair<const uint64_t, size_t>>;
+			container::concurrent_hash_map<uint64_t, size_t, hash<uint64_t>, equal_to<uint64_t>, allocator_type> map{
+				0, 0, hash<uint64_t>{}, equal_to<uint64_t>{}, allocator_type{ pool } };
+			prefill(map);
+			runner.run_threads("map/concurrent_hash_map<BlockPoolAllocator>", threads, [&map](size_t thread_idx, size_t operations) {
+				map_mixed_access(map, thread_idx, operations);
+			});
+		}
+		{
+			locked_map<uint64_t, size_t> map;
+			prefill(map);
+			runner.run_threads("map/mutex+std::unordered_map", threads, [&map](size_t thread_idx, size_t operations) {
+				map_mixed_access(map, thread_idx, operations);
+			});
+		}
+	}
+	return EXIT_SUCCESS;
+}
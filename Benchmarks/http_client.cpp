@@ -0,0 +1,428 @@
+#include "benchmark.h"
+#include "../Web/http_client.h"
+
+#include <boost/asio/strand.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast.hpp>
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+#include <condition_variable>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+Load generator for http::Client against an in-process Beast server on
+loopback: for every request mix and concurrency level, a closed loop
+keeps the given number of requests in flight through
+Client::SendRequest() for 10 x --min-time seconds and reports
+throughput, latency percentiles, heap allocations per request made by
+the client side (the server threads aren't counted) and the peak number
+of open descriptors. Extra options:
+  --mix=kind:weight,...   small (64 B), large (64 KiB), slow (5 ms)
+  --concurrency=N,...     requests in flight, 1,16,64,256 by default
+  --io-threads=N          ClientSettings::io_threads, 0 by default
+  --server-threads=N      1 by default
+  --sharding=rr|host      ClientSettings::sharding, rr by default
+*********************************************************************/
+namespace {
+	atomic<size_t> g_allocations{ 0 };
+	thread_local bool t_uncounted{ false };										//Set by the server threads
+
+	void* counted_allocate(size_t size) {
+		if (!t_uncounted) {
+			g_allocations.fetch_add(1, memory_order_relaxed);
+		}
+		if (void* ptr = malloc(size ? size : 1)) {
+			return ptr;
+		}
+		throw bad_alloc{};
+	}
+	void* counted_allocate(size_t size, align_val_t alignment) {
+		if (!t_uncounted) {
+			g_allocations.fetch_add(1, memory_order_relaxed);
+		}
+		const size_t align{ static_cast<size_t>(alignment) };
+		if (void* ptr = aligned_alloc(align, (size + align - 1) / align * align)) {
+			return ptr;
+		}
+		throw bad_alloc{};
+	}
+}
+
+void* operator new(size_t size) { return counted_allocate(size); }
+void* operator new[](size_t size) { return counted_allocate(size); }
+void* operator new(size_t size, align_val_t alignment) { return counted_allocate(size, alignment); }
+void* operator new[](size_t size, align_val_t alignment) { return counted_allocate(size, alignment); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, align_val_t) noexcept { free(ptr); }
+
+namespace {
+	namespace net = boost::asio;
+	namespace beast = boost::beast;
+	namespace http = beast::http;
+	using tcp = net::ip::tcp;
+
+	constexpr size_t SMALL_BODY{ 64 },
+		LARGE_BODY{ 64 * 1024 },
+		MAX_LATENCY_SAMPLES{ 1 << 22 };
+	constexpr chrono::milliseconds SLOW_DELAY{ 5 };
+
+	/*********************************************************************
+	Keep-alive HTTP/1.1 server: /bytes/<n> answers with n bytes,
+	/delay/<ms> answers with SMALL_BODY bytes after the delay
+	*********************************************************************/
+	class server_connection : public enable_shared_from_this<server_connection> {
+	public:
+		explicit server_connection(tcp::socket socket)
+			: m_socket{ move(socket) }, m_timer{ m_socket.get_executor() }
+		{
+		}
+		void start() {
+			read();
+		}
+	private:
+		void read() {
+			m_request = {};
+			http::async_read(m_socket, m_buffer, m_request, [self = shared_from_this()](beast::error_code error, size_t) {
+				if (!error) {
+					self->respond();
+				}
+			});
+		}
+		void respond() {
+			const string_view target{ m_request.target().data(), m_request.target().size() };
+			size_t body_size{ SMALL_BODY };
+			chrono::milliseconds delay{ 0 };
+			if (target.rfind("/bytes/", 0) == 0) {
+				body_size = static_cast<size_t>(atoll(string{ target.substr(7) }.c_str()));
+			}
+			else if (target.rfind("/delay/", 0) == 0) {
+				delay = chrono::milliseconds{ atoll(string{ target.substr(7) }.c_str()) };
+			}
+			m_response = { http::status::ok, m_request.version() };
+			m_response.set(http::field::content_type, "application/octet-stream");
+			m_response.body().assign(body_size, 'x');
+			m_response.keep_alive(m_request.keep_alive());
+			m_response.prepare_payload();
+			if (delay.count() == 0) {
+				write();
+			}
+			else {
+				m_timer.expires_after(delay);
+				m_timer.async_wait([self = shared_from_this()](beast::error_code) { self->write(); });
+			}
+		}
+		void write() {
+			http::async_write(m_socket, m_response, [self = shared_from_this()](beast::error_code error, size_t) {
+				if (!error && self->m_response.keep_alive()) {
+					self->read();
+				}
+			});
+		}
+	private:
+		tcp::socket m_socket;
+		net::steady_timer m_timer;
+		beast::flat_buffer m_buffer;
+		http::request<http::string_body> m_request;
+		http::response<http::string_body> m_response;
+	};
+
+	class loopback_server {
+	public:
+		explicit loopback_server(size_t thread_count)
+			: m_io{ static_cast<int>(thread_count) },
+			m_acceptor{ m_io, { net::ip::make_address("127.0.0.1"), 0 } }
+		{
+			accept();
+			for (size_t idx = 0; idx < thread_count; ++idx) {
+				m_threads.emplace_back([this] {
+					t_uncounted = true;
+					m_io.run();
+				});
+			}
+		}
+		loopback_server(const loopback_server&) = delete;
+		loopback_server& operator=(const loopback_server&) = delete;
+		~loopback_server() {
+			m_io.stop();
+			for (auto& thread : m_threads) {
+				thread.join();
+			}
+		}
+	public:
+		unsigned short port() const {
+			return m_acceptor.local_endpoint().port();
+		}
+		size_t accepted() const noexcept {
+			return m_accepted.load(memory_order_relaxed);
+		}
+	private:
+		void accept() {
+			m_acceptor.async_accept(net::make_strand(m_io), [this](beast::error_code error, tcp::socket socket) {
+				if (error) {
+					return;
+				}
+				m_accepted.fetch_add(1, memory_order_relaxed);
+				socket.set_option(tcp::no_delay{ true });
+				make_shared<server_connection>(move(socket))->start();
+				accept();
+			});
+		}
+	private:
+		net::io_context m_io;
+		tcp::acceptor m_acceptor;
+		vector<thread> m_threads;
+		atomic<size_t> m_accepted{ 0 };
+	};
+
+	struct request_kind {
+		string name,
+			target;
+		size_t weight;
+	};
+
+	struct load_settings {
+		vector<request_kind> mix{ { "small", "/bytes/" + to_string(SMALL_BODY), 1 } };
+		vector<size_t> concurrency{ 1, 16, 64, 256 };
+		size_t io_threads{ 0 },
+			server_threads{ 1 };
+		web::http::ShardingPolicy sharding{ web::http::ShardingPolicy::RoundRobin };
+	};
+
+	vector<string> split(const string& text, char separator) {
+		vector<string> parts;
+		size_t first{ 0 };
+		for (size_t last = text.find(separator); ; last = text.find(separator, first)) {
+			parts.push_back(text.substr(first, last - first));
+			if (last == string::npos) {
+				return parts;
+			}
+			first = last + 1;
+		}
+	}
+
+	bool parse_mix(const string& text, vector<request_kind>& mix) {
+		mix.clear();
+		for (const string& part : split(text, ',')) {
+			const auto parts{ split(part, ':') };
+			const size_t weight{ parts.size() == 2 ? static_cast<size_t>(atoll(parts[1].c_str())) : 1 };
+			if (parts[0] == "small") {
+				mix.push_back({ "small", "/bytes/" + to_string(SMALL_BODY), weight });
+			}
+			else if (parts[0] == "large") {
+				mix.push_back({ "large", "/bytes/" + to_string(LARGE_BODY), weight });
+			}
+			else if (parts[0] == "slow") {
+				mix.push_back({ "slow", "/delay/" + to_string(SLOW_DELAY.count()), weight });
+			}
+			else {
+				return false;
+			}
+		}
+		return !mix.empty();
+	}
+
+	class load_driver {															//Closed loop: every completion sends the next request
+	public:
+		load_driver(web::http::Client& client, unsigned short port, const vector<request_kind>& mix)
+			: m_client{ client }, m_latencies(MAX_LATENCY_SAMPLES)
+		{
+			for (const auto& kind : mix) {
+				web::http::request req{ web::http::method::get, kind.target, 11 };
+				req.set(web::http::field::host, "127.0.0.1");
+				req.set(web::http::field::protocol, to_string(port));
+				req.keep_alive(true);
+				m_requests.insert(m_requests.end(), (max)(kind.weight, size_t{ 1 }), req);	//Picked round-robin, so weights hold exactly
+			}
+		}
+	public:
+		void run(size_t concurrency, chrono::duration<double> duration) {
+			m_completed = m_failed = 0;
+			m_deadline = benchmark::clock::now() + chrono::duration_cast<benchmark::clock::duration>(duration);
+			m_in_flight = concurrency;
+			for (size_t idx = 0; idx < concurrency; ++idx) {
+				send();
+			}
+			unique_lock lock{ m_mtx };
+			m_done.wait(lock, [this] { return m_in_flight.load() == 0; });
+		}
+
+		size_t completed() const noexcept {
+			return m_completed.load();
+		}
+		size_t failed() const noexcept {
+			return m_failed.load();
+		}
+		vector<double> latencies() const {
+			const size_t count{ (min)(m_completed.load(), m_latencies.size()) };
+			return { m_latencies.begin(), m_latencies.begin() + static_cast<ptrdiff_t>(count) };
+		}
+	private:
+		void send() {
+			const size_t idx{ m_next_request.fetch_add(1, memory_order_relaxed) % m_requests.size() };
+			const auto start{ benchmark::clock::now() };
+			m_client.SendRequest(m_requests[idx], [this, start](web::http::session_holder session) {
+				const auto finish{ benchmark::clock::now() };
+				if (session->GetError()) {
+					m_failed.fetch_add(1, memory_order_relaxed);
+				}
+				const size_t sample{ m_completed.fetch_add(1, memory_order_relaxed) };
+				if (sample < m_latencies.size()) {
+					m_latencies[sample] = chrono::duration<double, nano>(finish - start).count();
+				}
+				if (finish < m_deadline) {
+					send();
+				}
+				else if (m_in_flight.fetch_sub(1) == 1) {
+					lock_guard lock{ m_mtx };
+					m_done.notify_all();
+				}
+			});
+		}
+	private:
+		web::http::Client& m_client;
+		vector<web::http::request> m_requests;
+		vector<double> m_latencies;
+		atomic<size_t> m_next_request{ 0 },
+			m_completed{ 0 },
+			m_failed{ 0 },
+			m_in_flight{ 0 };
+		benchmark::clock::time_point m_deadline;
+		mutex m_mtx;
+		condition_variable m_done;
+	};
+
+	class descriptor_sampler {													//Peak number of open descriptors while alive
+	public:
+		descriptor_sampler()
+			: m_thread{ [this] {
+				t_uncounted = true;
+				unique_lock lock{ m_mtx };
+				do {
+					m_peak = (max)(m_peak, benchmark::open_descriptors().value_or(0));
+				} while (!m_stopped.wait_for(lock, chrono::milliseconds{ 5 }, [this] { return m_stop; }));
+			} }
+		{
+		}
+		~descriptor_sampler() {
+			stop();
+		}
+		size_t stop() {
+			{
+				lock_guard lock{ m_mtx };
+				m_stop = true;
+			}
+			m_stopped.notify_all();
+			if (m_thread.joinable()) {
+				m_thread.join();
+			}
+			return m_peak;
+		}
+	private:
+		mutex m_mtx;
+		condition_variable m_stopped;
+		bool m_stop{ false };
+		size_t m_peak{ 0 };
+		thread m_thread;
+	};
+
+	string mix_name(const vector<request_kind>& mix) {
+		string name;
+		for (const auto& kind : mix) {
+			name += (name.empty() ? "" : "+") + kind.name + (mix.size() > 1 ? ":" + to_string(kind.weight) : "");
+		}
+		return name;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	load_settings settings;
+	const auto opts{ benchmark::parse_options(argc, argv, [&settings](const string& arg) {
+		const auto value_of = [&arg](const string& name) -> const char* {
+			return arg.rfind(name + "=", 0) == 0 ? arg.c_str() + name.size() + 1 : nullptr;
+		};
+		if (const char* value = value_of("--mix")) {
+			return parse_mix(value, settings.mix);
+		}
+		if (const char* value = value_of("--concurrency")) {
+			settings.concurrency.clear();
+			for (const string& level : split(value, ',')) {
+				settings.concurrency.push_back((max)(static_cast<size_t>(atoll(level.c_str())), size_t{ 1 }));
+			}
+			return true;
+		}
+		if (const char* value = value_of("--io-threads")) {
+			settings.io_threads = static_cast<size_t>(atoll(value));
+			return true;
+		}
+		if (const char* value = value_of("--server-threads")) {
+			settings.server_threads = (max)(static_cast<size_t>(atoll(value)), size_t{ 1 });
+			return true;
+		}
+		if (const char* value = value_of("--sharding")) {
+			settings.sharding = string{ value } == "host" ? web::http::ShardingPolicy::ByHost : web::http::ShardingPolicy::RoundRobin;
+			return string{ value } == "host" || string{ value } == "rr";
+		}
+		return false;
+	}, " [--mix=small:90,large:9,slow:1] [--concurrency=1,16,64,256] [--io-threads=N] [--server-threads=N] [--sharding=rr|host]") };
+	benchmark::runner runner{ opts };
+	const chrono::duration<double> duration{ 10 * opts.min_time };
+
+	loopback_server server{ settings.server_threads };
+	for (const size_t concurrency : settings.concurrency) {
+		const string name{ "http/" + mix_name(settings.mix) + "/concurrency " + to_string(concurrency) };
+		if (!runner.selected(name)) {
+			continue;
+		}
+		const size_t descriptors_before{ benchmark::open_descriptors().value_or(0) };	//Without the client's connections
+		web::http::ClientSettings client_settings;
+		client_settings.io_threads = settings.io_threads;
+		client_settings.sharding = settings.sharding;
+		client_settings.connections.max_idle_per_host = concurrency;
+		client_settings.connections.max_total_per_host = concurrency;
+		client_settings.limits.max_in_flight = (max)(client_settings.limits.max_in_flight, concurrency);
+		web::http::Client client{ client_settings };
+		load_driver driver{ client, server.port(), settings.mix };
+		driver.run(concurrency, duration / 10);								//Warm-up: connections, pools and caches
+
+		const size_t accepted_before{ server.accepted() },
+			allocations_before{ g_allocations.load() };
+		descriptor_sampler sampler;
+		const auto start{ benchmark::clock::now() };
+		driver.run(concurrency, duration);
+		const double elapsed{ chrono::duration<double>(benchmark::clock::now() - start).count() };
+		const size_t allocations{ g_allocations.load() - allocations_before },
+			descriptors_peak{ sampler.stop() },
+			requests{ driver.completed() };
+
+		auto latencies{ driver.latencies() };
+		char text[256];
+		snprintf(text, sizeof(text), "%.0f req/s, %zu requests, %zu failed, %.1f client allocations/request, %zu io threads",
+			static_cast<double>(requests) / elapsed, requests, driver.failed(),
+			requests ? static_cast<double>(allocations) / static_cast<double>(requests) : 0.0, client.IoThreads());
+		runner.note(name, text);
+		runner.note(name, benchmark::latency_summary(latencies));
+		snprintf(text, sizeof(text), "open descriptors: %zu without the client, %zu peak; %zu server connections accepted after the warm-up",
+			descriptors_before, descriptors_peak, server.accepted() - accepted_before);
+		runner.note(name, text);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+#include "benchmark.h"
+#include "../Web/thread_pool.hpp"
+#include "../Mutithreading/execution_algorithms.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+using namespace utility;
+using concurrency::ThreadPool;
+
+/*********************************************************************
+ThreadPool scheduling costs:
+- tasks: throughput of empty tasks submitted by 1..N producers, timed
+  until the pool is idle again;
+- latency: submit-to-start (wake-up) and Schedule()/future round trip
+  percentiles, against std::async;
+- fan-out: a batch of small tasks scheduled and awaited at once;
+- parallel_for: speedup of a chunked loop over the pool at 1..N
+  workers on uniform and skewed work, against execution::parallel_for
+  (std::async) and a sequential loop
+*********************************************************************/
+namespace {
+	constexpr size_t LOOP_SIZE{ 1 << 18 },
+		FAN_OUT_PER_WORKER{ 4 },
+		ASYNC_BATCH{ 64 },														//std::async threads alive at once
+		MAX_LATENCY_SAMPLES{ 100000 };
+	constexpr uint64_t FAN_OUT_TASK_COST{ 1000 };
+
+	size_t hardware_threads() noexcept {
+		return (max)(thread::hardware_concurrency(), 1u);
+	}
+
+	uint64_t spin(uint64_t steps) noexcept {									//CPU-bound work without memory traffic
+		uint64_t state{ steps };
+		for (uint64_t idx = 0; idx < steps; ++idx) {
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+		}
+		return state;
+	}
+
+	uint64_t uniform_cost(size_t) noexcept {
+		return 64;
+	}
+	uint64_t skewed_cost(size_t idx) noexcept {									//Same total as uniform, but the last quarter carries most of it
+		return idx < LOOP_SIZE / 4 * 3 ? 16 : 208;
+	}
+
+	void run_tasks(benchmark::runner& runner, size_t max_threads) {
+		ThreadPool pool{ hardware_threads() };
+		for (const size_t producers : benchmark::thread_counts(max_threads)) {
+			runner.run_threads("tasks/ThreadPool::Enqueue", producers, [&pool](size_t, size_t operations) {
+				for (size_t idx = 0; idx < operations; ++idx) {
+					pool.Enqueue([] {});
+				}
+			}, [&pool] { pool.WaitIdle(); });
+			runner.run_threads("tasks/ThreadPool::Schedule", producers, [&pool](size_t, size_t operations) {
+				vector<future<void>> futures;
+				futures.reserve(operations);
+				for (size_t idx = 0; idx < operations; ++idx) {
+					futures.push_back(pool.Schedule([] {}));
+				}
+				for (auto& result : futures) {
+					result.get();
+				}
+			});
+			runner.run_threads("tasks/std::async", producers, [](size_t, size_t operations) {
+				vector<future<void>> futures;
+				futures.reserve(ASYNC_BATCH);
+				for (size_t done = 0; done < operations; done += futures.size()) {
+					futures.clear();
+					for (size_t idx = done; idx < (min)(done + ASYNC_BATCH, operations); ++idx) {
+						futures.push_back(async(launch::async, [] {}));
+					}
+					for (auto& result : futures) {
+						result.get();
+					}
+				}
+			});
+		}
+	}
+
+	template <class Submit>
+	vector<double> sample_latency(const benchmark::options& opts, bool idle_workers, Submit&& submit) {	//submit() returns nanoseconds
+		vector<double> samples;
+		const auto deadline{ benchmark::clock::now() + chrono::duration<double>(opts.min_time * static_cast<double>(opts.repetitions)) };
+		while (samples.size() < MAX_LATENCY_SAMPLES && (samples.size() < 100 || benchmark::clock::now() < deadline)) {
+			if (idle_workers) {
+				this_thread::sleep_for(chrono::microseconds{ 200 });			//Lets the workers park
+			}
+			samples.push_back(submit());
+		}
+		return samples;
+	}
+
+	void run_latency(benchmark::runner& runner) {
+		ThreadPool pool{ hardware_threads() };
+		const auto elapsed_ns = [](benchmark::clock::time_point from, benchmark::clock::time_point to) {
+			return chrono::duration<double, nano>(to - from).count();
+		};
+		const auto round_trip = [&](auto&& schedule) {
+			return [&, schedule] {
+				const auto start{ benchmark::clock::now() };
+				schedule().get();
+				return elapsed_ns(start, benchmark::clock::now());
+			};
+		};
+		const auto wake_up = [&](auto&& schedule) {
+			return [&, schedule] {
+				const auto start{ benchmark::clock::now() };
+				return elapsed_ns(start, schedule().get());
+			};
+		};
+		const auto schedule_empty{ [&pool] { return pool.Schedule([] {}); } };
+		const auto schedule_clock{ [&pool] { return pool.Schedule([] { return benchmark::clock::now(); }); } };
+		const auto async_empty{ [] { return async(launch::async, [] {}); } };
+		const auto async_clock{ [] { return async(launch::async, [] { return benchmark::clock::now(); }); } };
+
+		const auto measure = [&runner](const string& name, bool idle_workers, auto&& submit) {
+			if (runner.selected(name)) {
+				auto samples{ sample_latency(runner.settings(), idle_workers, submit) };
+				runner.note(name, benchmark::latency_summary(samples));
+			}
+		};
+		measure("latency/round-trip/ThreadPool::Schedule/busy", false, round_trip(schedule_empty));
+		measure("latency/round-trip/ThreadPool::Schedule/idle", true, round_trip(schedule_empty));
+		measure("latency/round-trip/std::async", false, round_trip(async_empty));
+		measure("latency/wake-up/ThreadPool::Schedule/idle", true, wake_up(schedule_clock));
+		measure("latency/wake-up/std::async", true, wake_up(async_clock));
+	}
+
+	void run_fan_out(benchmark::runner& runner) {								//Operations: batches
+		const size_t workers{ hardware_threads() },
+			batch{ workers * FAN_OUT_PER_WORKER };
+		ThreadPool pool{ workers };
+		runner.run("fan-out/ThreadPool/" + to_string(batch) + " tasks", [&pool, batch](size_t operations) {
+			vector<future<uint64_t>> futures;
+			futures.reserve(batch);
+			for (size_t done = 0; done < operations; ++done) {
+				futures.clear();
+				for (size_t idx = 0; idx < batch; ++idx) {
+					futures.push_back(pool.Schedule(spin, FAN_OUT_TASK_COST));
+				}
+				uint64_t sum{ 0 };
+				for (auto& result : futures) {
+					sum += result.get();
+				}
+				benchmark::do_not_optimize(sum);
+			}
+		});
+		runner.run("fan-out/std::async/" + to_string(batch) + " tasks", [batch](size_t operations) {
+			vector<future<uint64_t>> futures;
+			futures.reserve(batch);
+			for (size_t done = 0; done < operations; ++done) {
+				futures.clear();
+				for (size_t idx = 0; idx < batch; ++idx) {
+					futures.push_back(async(launch::async, spin, FAN_OUT_TASK_COST));
+				}
+				uint64_t sum{ 0 };
+				for (auto& result : futures) {
+					sum += result.get();
+				}
+				benchmark::do_not_optimize(sum);
+			}
+		});
+		runner.run("fan-out/sequential/" + to_string(batch) + " tasks", [batch](size_t operations) {
+			for (size_t done = 0; done < operations; ++done) {
+				uint64_t sum{ 0 };
+				for (size_t idx = 0; idx < batch; ++idx) {
+					sum += spin(FAN_OUT_TASK_COST);
+				}
+				benchmark::do_not_optimize(sum);
+			}
+		});
+	}
+
+	template <class Function>
+	void pool_for(ThreadPool& pool, size_t chunk_count, size_t count, Function func) {	//Contiguous chunks, one task each
+		vector<future<void>> futures;
+		futures.reserve(chunk_count);
+		const size_t chunk{ (count + chunk_count - 1) / chunk_count };
+		for (size_t first = 0; first < count; first += chunk) {
+			futures.push_back(pool.Schedule([first, last = (min)(first + chunk, count), &func] {
+				for (size_t idx = first; idx < last; ++idx) {
+					func(idx);
+				}
+			}));
+		}
+		for (auto& result : futures) {
+			result.get();
+		}
+	}
+
+	void run_parallel_for(benchmark::runner& runner, size_t max_threads) {		//Operations: loop iterations
+		vector<size_t> indices(LOOP_SIZE);
+		for (size_t idx = 0; idx < LOOP_SIZE; ++idx) {
+			indices[idx] = idx;
+		}
+		for (const auto& [workload, cost] : { pair{ "uniform", &uniform_cost }, pair{ "skewed", &skewed_cost } }) {
+			const string prefix{ string{ "parallel_for/" } + workload };
+			const auto body = [cost = cost](size_t idx) { benchmark::do_not_optimize(spin(cost(idx))); };
+			const auto loops = [](size_t operations, auto&& loop) {				//Whole loops, then a shorter one for the rest
+				for (size_t done = 0; done < operations; done += LOOP_SIZE) {
+					loop((min)(LOOP_SIZE, operations - done));
+				}
+			};
+
+			const auto baseline{ runner.run(prefix + "/sequential", [&](size_t operations) {
+				loops(operations, [&](size_t count) {
+					execution::sequential_for(indices.begin(), indices.begin() + static_cast<ptrdiff_t>(count), body);
+				});
+			}) };
+			const auto report_speedup = [&runner, &baseline](const string& name, const optional<double>& ns_per_op) {
+				if (baseline && ns_per_op) {
+					char text[64];
+					snprintf(text, sizeof(text), "speedup %.2fx over sequential", *baseline / *ns_per_op);
+					runner.note(name, text);
+				}
+			};
+			const string async_name{ prefix + "/execution::parallel_for (std::async)" };
+			report_speedup(async_name, runner.run(async_name, [&](size_t operations) {
+				loops(operations, [&](size_t count) {
+					execution::parallel_for(indices.begin(), indices.begin() + static_cast<ptrdiff_t>(count), body);
+				});
+			}));
+			for (const size_t workers : benchmark::thread_counts(max_threads)) {
+				ThreadPool pool{ workers };
+				for (const size_t chunks_per_worker : { size_t{ 1 }, size_t{ 16 } }) {	//Static split vs finer chunks to balance skewed work
+					const string name{ prefix + "/ThreadPool/" + to_string(workers) + " workers/" + to_string(chunks_per_worker * workers) + " chunks" };
+					report_speedup(name, runner.run(name, [&](size_t operations) {
+						loops(operations, [&](size_t count) {
+							pool_for(pool, chunks_per_worker * workers, count, body);
+						});
+					}));
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[]) {
+	benchmark::runner runner{ benchmark::parse_options(argc, argv) };
+	const size_t max_threads{ runner.settings().max_threads };
+	run_tasks(runner, max_threads);
+	run_latency(runner);
+	run_fan_out(runner);
+	run_parallel_for(runner, (min)(max_threads, 2 * hardware_threads()));
+	return EXIT_SUCCESS;
+}
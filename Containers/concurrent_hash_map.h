@@ -0,0 +1,236 @@
+#pragma once
+#include "flat_hash_map.h"
+#include "mpmc_queue.h"															//CACHE_LINE_SIZE
+
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <shared_mutex>
+
+namespace utility::container {
+	/*********************************************************************
+	Hash map for concurrent access: the keys are spread over independent
+	shards, each of them a flat_hash_map behind its own reader-writer
+	lock, so threads working with different shards never contend. A shard
+	occupies whole cache lines to avoid false sharing between the locks.
+	References to the elements are never handed out: lookups return
+	copies or run a visitor under the shard lock
+	*********************************************************************/
+	template <class Key, class Ty, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+		class Allocator = std::allocator<std::pair<const Key, Ty>>>
+	class concurrent_hash_map {
+	public:
+		using key_type = Key;
+		using mapped_type = Ty;
+		using value_type = std::pair<const Key, Ty>;
+		using size_type = size_t;
+		using hasher = Hash;
+		using key_equal = KeyEqual;
+		using allocator_type = Allocator;
+		using map_type = flat_hash_map<Key, Ty, Hash, KeyEqual, Allocator>;
+	private:
+		struct alignas(CACHE_LINE_SIZE) shard_type {
+			shard_type(size_t bucket_count, const Hash& hash, const KeyEqual& equal, const Allocator& alloc)
+				: map(bucket_count, hash, equal, alloc)
+			{
+			}
+
+			mutable std::shared_mutex lock;
+			map_type map;
+		};
+
+		using shard_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<shard_type>;
+		using shard_traits = std::allocator_traits<shard_allocator>;
+	public:
+		explicit concurrent_hash_map(size_t shard_count = 0, size_t bucket_count = 0, const Hash& hash = Hash{},	//0 shards: 4 per hardware thread
+			const KeyEqual& equal = KeyEqual{}, const Allocator& alloc = Allocator{})
+			: m_hash{ hash },
+			m_alloc(alloc),
+			m_shard_count{ round_up_to_power_of_two(shard_count ? shard_count : default_shard_count()) },
+			m_shard_shift{ 64 - log2(m_shard_count) }
+		{
+			m_shards = shard_traits::allocate(m_alloc, m_shard_count);
+			size_t constructed{ 0 };
+			try {
+				const size_t buckets_per_shard{ (bucket_count + m_shard_count - 1) / m_shard_count };
+				for (; constructed < m_shard_count; ++constructed) {
+					shard_traits::construct(m_alloc, m_shards + constructed, buckets_per_shard, hash, equal, alloc);
+				}
+			}
+			catch (...) {
+				destroy(constructed);
+				throw;
+			}
+		}
+		concurrent_hash_map(const concurrent_hash_map&) = delete;
+		concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+		~concurrent_hash_map() {
+			destroy(m_shard_count);
+		}
+	public:
+		template <class... Types>
+		bool emplace(Types&&... args) {											//False if the key is already present
+			value_type value(std::forward<Types>(args)...);
+			auto& shard{ shard_for(value.first) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.emplace(std::move(value)).second;
+		}
+		bool insert(const value_type& value) {
+			auto& shard{ shard_for(value.first) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.insert(value).second;
+		}
+		bool insert(value_type&& value) {
+			auto& shard{ shard_for(value.first) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.insert(std::move(value)).second;
+		}
+		template <class... Types>
+		bool try_emplace(const Key& key, Types&&... args) {						//Constructs the value only if the key is new
+			auto& shard{ shard_for(key) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.try_emplace(key, std::forward<Types>(args)...).second;
+		}
+		template <class... Types>
+		bool try_emplace(Key&& key, Types&&... args) {
+			auto& shard{ shard_for(key) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.try_emplace(std::move(key), std::forward<Types>(args)...).second;
+		}
+		template <class Value>
+		bool insert_or_assign(const Key& key, Value&& value) {					//True if inserted, false if assigned
+			auto& shard{ shard_for(key) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.insert_or_assign(key, std::forward<Value>(value)).second;
+		}
+		template <class Value>
+		bool insert_or_assign(Key&& key, Value&& value) {
+			auto& shard{ shard_for(key) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.insert_or_assign(std::move(key), std::forward<Value>(value)).second;
+		}
+
+		std::optional<Ty> find(const Key& key) const {							//A copy: the element may be erased right after the lookup
+			const auto& shard{ shard_for(key) };
+			std::shared_lock lock{ shard.lock };
+			const auto where{ shard.map.find(key) };
+			if (where == shard.map.end()) {
+				return std::nullopt;
+			}
+			return where->second;
+		}
+		bool contains(const Key& key) const {
+			const auto& shard{ shard_for(key) };
+			std::shared_lock lock{ shard.lock };
+			return shard.map.contains(key);
+		}
+
+		template <class Visitor>
+		bool visit(const Key& key, Visitor&& visitor) {							//Calls visitor(Ty&) under the exclusive lock; false if there is no such key
+			auto& shard{ shard_for(key) };
+			std::unique_lock lock{ shard.lock };
+			const auto where{ shard.map.find(key) };
+			if (where == shard.map.end()) {
+				return false;
+			}
+			visitor(where->second);
+			return true;
+		}
+		template <class Visitor>
+		bool visit(const Key& key, Visitor&& visitor) const {					//Calls visitor(const Ty&) under the shared lock
+			const auto& shard{ shard_for(key) };
+			std::shared_lock lock{ shard.lock };
+			const auto where{ shard.map.find(key) };
+			if (where == shard.map.end()) {
+				return false;
+			}
+			visitor(std::as_const(where->second));
+			return true;
+		}
+		template <class Visitor>
+		void visit_all(Visitor&& visitor) const {								//Shard by shard: not a snapshot of the whole map
+			for (size_t idx = 0; idx < m_shard_count; ++idx) {
+				std::shared_lock lock{ m_shards[idx].lock };
+				for (const auto& value : m_shards[idx].map) {
+					visitor(value);
+				}
+			}
+		}
+
+		bool erase(const Key& key) {
+			auto& shard{ shard_for(key) };
+			std::unique_lock lock{ shard.lock };
+			return shard.map.erase(key) != 0;
+		}
+		void clear() {
+			for (size_t idx = 0; idx < m_shard_count; ++idx) {
+				std::unique_lock lock{ m_shards[idx].lock };
+				m_shards[idx].map.clear();
+			}
+		}
+		void reserve(size_t count) {											//Spread evenly over the shards
+			const size_t per_shard{ (count + m_shard_count - 1) / m_shard_count };
+			for (size_t idx = 0; idx < m_shard_count; ++idx) {
+				std::unique_lock lock{ m_shards[idx].lock };
+				m_shards[idx].map.reserve(per_shard);
+			}
+		}
+
+		size_t size() const {													//Approximate under concurrent modification
+			size_t total{ 0 };
+			for (size_t idx = 0; idx < m_shard_count; ++idx) {
+				std::shared_lock lock{ m_shards[idx].lock };
+				total += m_shards[idx].map.size();
+			}
+			return total;
+		}
+		bool empty() const {
+			return size() == 0;
+		}
+		size_t shard_count() const noexcept {
+			return m_shard_count;
+		}
+		allocator_type get_allocator() const {
+			return allocator_type(m_alloc);
+		}
+	private:
+		shard_type& shard_for(const Key& key) const noexcept {					//The top bits: the shard maps use the low ones
+			const uint64_t hash{ static_cast<uint64_t>(m_hash(key)) * 0xFF51AFD7ED558CCDull };
+			return m_shards[m_shard_count == 1 ? 0 : static_cast<size_t>(hash >> m_shard_shift)];
+		}
+		void destroy(size_t constructed) noexcept {
+			for (size_t idx = 0; idx < constructed; ++idx) {
+				shard_traits::destroy(m_alloc, m_shards + idx);
+			}
+			shard_traits::deallocate(m_alloc, m_shards, m_shard_count);
+		}
+
+		static size_t default_shard_count() noexcept {
+			return 4 * (std::max)(std::thread::hardware_concurrency(), 1u);
+		}
+		static size_t round_up_to_power_of_two(size_t value) noexcept {
+			size_t power{ 1 };
+			while (power < value) {
+				power <<= 1;
+			}
+			return power;
+		}
+		static unsigned int log2(size_t power_of_two) noexcept {
+			unsigned int bits{ 0 };
+			while (power_of_two >>= 1) {
+				++bits;
+			}
+			return bits;
+		}
+	private:
+		Hash m_hash;
+		shard_allocator m_alloc;
+		const size_t m_shard_count;
+		const unsigned int m_shard_shift;
+		shard_type* m_shards{ nullptr };
+	};
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <utility>
+#include <cstddef>
 #include <type_traits>
 
 namespace utility::container {
@@ -123,6 +125,17 @@ namespace utility::container {
 	template <class Ty>
 	inline constexpr bool is_associative_v = is_associative<Ty>::value;
 
+	template <class Ty, class = void>
+	struct is_ordered																//Sorted by key_compare: std::set, std::map and the like
+		: std::false_type {};
+
+	template <class Ty>
+	struct is_ordered<Ty, std::void_t<typename Ty::key_compare>>
+		: std::true_type {};
+
+	template <class Ty>
+	inline constexpr bool is_ordered_v = is_ordered<Ty>::value;
+
 	template <class Ty, class = void>
 	struct data_type {
 		using type = typename Ty::value_type;
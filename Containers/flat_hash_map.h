@@ -0,0 +1,71 @@
+#pragma once
+#include "raw_hash_table.h"
+
+#include <tuple>
+#include <stdexcept>
+
+namespace utility::container {
+	template <class Key, class Ty, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+		class Allocator = std::allocator<std::pair<const Key, Ty>>>
+	class flat_hash_map																//Elements are stored inline in the slot array: they move on rehashing,
+		: public details::raw_hash_table<details::map_policy<Key, Ty>, Hash, KeyEqual, Allocator> {	//so references don't survive an insertion
+	private:
+		using MyBase = details::raw_hash_table<details::map_policy<Key, Ty>, Hash, KeyEqual, Allocator>;
+	public:
+		using mapped_type = Ty;
+		using typename MyBase::iterator;
+	public:
+		using MyBase::MyBase;
+	public:
+		Ty& operator[](const Key& key) {
+			return try_emplace(key).first->second;
+		}
+		Ty& operator[](Key&& key) {
+			return try_emplace(std::move(key)).first->second;
+		}
+		Ty& at(const Key& key) {
+			const auto where{ this->find(key) };
+			if (where == this->end()) {
+				throw std::out_of_range("Key not found");
+			}
+			return where->second;
+		}
+		const Ty& at(const Key& key) const {
+			const auto where{ this->find(key) };
+			if (where == this->end()) {
+				throw std::out_of_range("Key not found");
+			}
+			return where->second;
+		}
+
+		template <class... Types>
+		std::pair<iterator, bool> try_emplace(const Key& key, Types&&... args) {	//Constructs the value only if the key is new
+			return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Types>(args)...));
+		}
+		template <class... Types>
+		std::pair<iterator, bool> try_emplace(Key&& key, Types&&... args) {
+			return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Types>(args)...));
+		}
+		template <class Value>
+		std::pair<iterator, bool> insert_or_assign(const Key& key, Value&& value) {
+			auto result{ try_emplace(key, std::forward<Value>(value)) };
+			if (!result.second) {
+				result.first->second = std::forward<Value>(value);				//Not moved from: nothing was inserted
+			}
+			return result;
+		}
+		template <class Value>
+		std::pair<iterator, bool> insert_or_assign(Key&& key, Value&& value) {
+			auto result{ try_emplace(std::move(key), std::forward<Value>(value)) };
+			if (!result.second) {
+				result.first->second = std::forward<Value>(value);
+			}
+			return result;
+		}
+	};
+
+	template <class Key, class Ty, class Hash, class KeyEqual, class Allocator>
+	void swap(flat_hash_map<Key, Ty, Hash, KeyEqual, Allocator>& lhs, flat_hash_map<Key, Ty, Hash, KeyEqual, Allocator>& rhs) noexcept {
+		lhs.swap(rhs);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "raw_hash_table.h"
+
+namespace utility::container {
+	template <class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>, class Allocator = std::allocator<Key>>
+	class flat_hash_set																//Elements are stored inline in the slot array: they move on rehashing
+		: public details::raw_hash_table<details::set_policy<Key>, Hash, KeyEqual, Allocator> {
+	private:
+		using MyBase = details::raw_hash_table<details::set_policy<Key>, Hash, KeyEqual, Allocator>;
+	public:
+		using MyBase::MyBase;
+	};
+
+	template <class Key, class Hash, class KeyEqual, class Allocator>
+	void swap(flat_hash_set<Key, Hash, KeyEqual, Allocator>& lhs, flat_hash_set<Key, Hash, KeyEqual, Allocator>& rhs) noexcept {
+		lhs.swap(rhs);
+	}
+}
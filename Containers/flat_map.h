@@ -0,0 +1,361 @@
+#pragma once
+#include "flat_search.h"
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <initializer_list>
+
+namespace utility::container {
+	template <class Key, class Ty, class Compare = std::less<Key>, class Search = search::binary,
+		class KeyContainer = std::vector<Key>, class MappedContainer = std::vector<Ty>>
+	class flat_map {															//Sorted unique keys and their values in two parallel arrays: a lookup
+	public:																		//scans only the keys, densely packed without the values in between
+		using key_type = Key;
+		using mapped_type = Ty;
+		using value_type = std::pair<Key, Ty>;
+		using key_compare = Compare;
+		using key_container_type = KeyContainer;
+		using mapped_container_type = MappedContainer;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = std::pair<const Key&, Ty&>;							//Proxies: the key and the value are stored apart
+		using const_reference = std::pair<const Key&, const Ty&>;
+	private:
+		template <bool is_const>
+		class iterator_base {
+		public:
+			using iterator_category = std::random_access_iterator_tag;
+			using value_type = flat_map::value_type;
+			using difference_type = flat_map::difference_type;
+			using reference = std::conditional_t<is_const, flat_map::const_reference, flat_map::reference>;
+
+			struct pointer {													//operator-> of a proxy
+				reference ref;
+				const reference* operator->() const noexcept { return &ref; }
+			};
+		private:
+			using key_iterator = typename KeyContainer::const_iterator;
+			using mapped_iterator = std::conditional_t<is_const,
+				typename MappedContainer::const_iterator, typename MappedContainer::iterator>;
+		public:
+			iterator_base() = default;
+			iterator_base(key_iterator key, mapped_iterator mapped)
+				: m_key{ key }, m_mapped{ mapped }
+			{
+			}
+			template <bool other_const, class = std::enable_if_t<is_const && !other_const>>
+			iterator_base(const iterator_base<other_const>& other)				//iterator to const_iterator
+				: m_key{ other.m_key }, m_mapped{ other.m_mapped }
+			{
+			}
+		public:
+			reference operator*() const { return { *m_key, *m_mapped }; }
+			pointer operator->() const { return { **this }; }
+			reference operator[](difference_type offset) const { return *(*this + offset); }
+
+			iterator_base& operator++() { ++m_key; ++m_mapped; return *this; }
+			iterator_base operator++(int) { auto old{ *this }; ++*this; return old; }
+			iterator_base& operator--() { --m_key; --m_mapped; return *this; }
+			iterator_base operator--(int) { auto old{ *this }; --*this; return old; }
+			iterator_base& operator+=(difference_type offset) { m_key += offset; m_mapped += offset; return *this; }
+			iterator_base& operator-=(difference_type offset) { return *this += -offset; }
+
+			friend iterator_base operator+(iterator_base it, difference_type offset) { return it += offset; }
+			friend iterator_base operator+(difference_type offset, iterator_base it) { return it += offset; }
+			friend iterator_base operator-(iterator_base it, difference_type offset) { return it -= offset; }
+			friend difference_type operator-(const iterator_base& lhs, const iterator_base& rhs) { return lhs.m_key - rhs.m_key; }
+
+			friend bool operator==(const iterator_base& lhs, const iterator_base& rhs) { return lhs.m_key == rhs.m_key; }
+			friend bool operator!=(const iterator_base& lhs, const iterator_base& rhs) { return lhs.m_key != rhs.m_key; }
+			friend bool operator<(const iterator_base& lhs, const iterator_base& rhs) { return lhs.m_key < rhs.m_key; }
+			friend bool operator>(const iterator_base& lhs, const iterator_base& rhs) { return lhs.m_key > rhs.m_key; }
+			friend bool operator<=(const iterator_base& lhs, const iterator_base& rhs) { return lhs.m_key <= rhs.m_key; }
+			friend bool operator>=(const iterator_base& lhs, const iterator_base& rhs) { return lhs.m_key >= rhs.m_key; }
+		private:
+			friend class flat_map;
+			friend class iterator_base<!is_const>;
+		private:
+			key_iterator m_key;
+			mapped_iterator m_mapped;
+		};
+	public:
+		using iterator = iterator_base<false>;
+		using const_iterator = iterator_base<true>;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	private:
+		using searcher_type = typename Search::template searcher<Key, Compare>;
+	public:
+		flat_map() = default;
+		explicit flat_map(const Compare& comp)
+			: m_comp{ comp }
+		{
+		}
+		template <class InputIt>
+		flat_map(InputIt first, InputIt last, const Compare& comp = Compare{})	//Unsorted input with duplicate keys: the first value of a key is kept
+			: m_comp{ comp }
+		{
+			for (; first != last; ++first) {
+				append_unsorted(*first);
+			}
+			sort_unique(0);
+		}
+		flat_map(std::initializer_list<value_type> init, const Compare& comp = Compare{})
+			: flat_map(init.begin(), init.end(), comp)
+		{
+		}
+		flat_map(KeyContainer keys, MappedContainer values, const Compare& comp = Compare{})	//Of equal length
+			: m_comp{ comp }, m_keys(std::move(keys)), m_values(std::move(values))
+		{
+			if (m_keys.size() != m_values.size()) {
+				throw std::invalid_argument("Keys and values differ in number");
+			}
+			sort_unique(0);
+		}
+	public:
+		iterator begin() noexcept { return { m_keys.cbegin(), m_values.begin() }; }
+		iterator end() noexcept { return { m_keys.cend(), m_values.end() }; }
+		const_iterator begin() const noexcept { return { m_keys.cbegin(), m_values.cbegin() }; }
+		const_iterator end() const noexcept { return { m_keys.cend(), m_values.cend() }; }
+		const_iterator cbegin() const noexcept { return begin(); }
+		const_iterator cend() const noexcept { return end(); }
+		reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+		reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+		const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+		const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+		bool empty() const noexcept { return m_keys.empty(); }
+		size_type size() const noexcept { return m_keys.size(); }
+		size_type capacity() const noexcept { return std::min(m_keys.capacity(), m_values.capacity()); }
+		void reserve(size_type count) { m_keys.reserve(count); m_values.reserve(count); }
+		void shrink_to_fit() { m_keys.shrink_to_fit(); m_values.shrink_to_fit(); }
+
+		key_compare key_comp() const { return m_comp; }
+		const KeyContainer& keys() const noexcept { return m_keys; }
+		const MappedContainer& values() const noexcept { return m_values; }
+
+		std::pair<KeyContainer, MappedContainer> extract() && {				//Leaves the map empty
+			std::pair<KeyContainer, MappedContainer> containers{ std::move(m_keys), std::move(m_values) };
+			clear();
+			return containers;
+		}
+
+		void clear() noexcept {
+			m_keys.clear();
+			m_values.clear();
+			m_searcher.rebuild(std::data(m_keys), 0);
+		}
+	public:
+		Ty& operator[](const Key& key) {
+			return try_emplace(key).first->second;
+		}
+		Ty& operator[](Key&& key) {
+			return try_emplace(std::move(key)).first->second;
+		}
+		Ty& at(const Key& key) {
+			return m_values[checked_idx(key)];
+		}
+		const Ty& at(const Key& key) const {
+			return m_values[checked_idx(key)];
+		}
+
+		template <class... Types>
+		std::pair<iterator, bool> emplace(Types&&... args) {
+			return insert(value_type(std::forward<Types>(args)...));
+		}
+		template <class... Types>
+		iterator emplace_hint(const_iterator hint, Types&&... args) {
+			return insert(hint, value_type(std::forward<Types>(args)...));
+		}
+		template <class K, class... Types>
+		std::pair<iterator, bool> try_emplace(K&& key, Types&&... args) {		//Constructs the value only if the key is new
+			return emplace_at(lower_bound_idx(key), std::forward<K>(key), std::forward<Types>(args)...);
+		}
+		template <class K, class Value>
+		std::pair<iterator, bool> insert_or_assign(K&& key, Value&& value) {
+			auto result{ try_emplace(std::forward<K>(key), std::forward<Value>(value)) };
+			if (!result.second) {
+				result.first->second = std::forward<Value>(value);			//Not moved from: nothing was inserted
+			}
+			return result;
+		}
+
+		std::pair<iterator, bool> insert(const value_type& value) {
+			return emplace_at(lower_bound_idx(value.first), value.first, value.second);
+		}
+		std::pair<iterator, bool> insert(value_type&& value) {
+			return emplace_at(lower_bound_idx(value.first), std::move(value.first), std::move(value.second));
+		}
+		iterator insert(const_iterator hint, const value_type& value) {
+			return emplace_at(hinted_idx(hint, value.first), value.first, value.second).first;
+		}
+		iterator insert(const_iterator hint, value_type&& value) {
+			return emplace_at(hinted_idx(hint, value.first), std::move(value.first), std::move(value.second)).first;
+		}
+		template <class InputIt>
+		void insert(InputIt first, InputIt last) {								//The new elements are sorted separately and merged in: O(n + m log m)
+			const size_t old_size{ m_keys.size() };
+			for (; first != last; ++first) {
+				append_unsorted(*first);
+			}
+			sort_unique(old_size);
+		}
+		void insert(std::initializer_list<value_type> init) {
+			insert(init.begin(), init.end());
+		}
+
+		iterator erase(const_iterator where) {
+			return erase(where, std::next(where));
+		}
+		iterator erase(const_iterator first, const_iterator last) {
+			const auto idx{ first.m_key - m_keys.cbegin() },
+				count{ last.m_key - first.m_key };
+			m_keys.erase(first.m_key, last.m_key);
+			m_values.erase(m_values.begin() + idx, m_values.begin() + idx + count);
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+			return begin() + idx;
+		}
+		size_type erase(const Key& key) {
+			const auto where{ find(key) };
+			if (where == end()) {
+				return 0;
+			}
+			erase(where);
+			return 1;
+		}
+
+		void swap(flat_map& other) noexcept {
+			using std::swap;
+			swap(m_comp, other.m_comp);
+			swap(m_keys, other.m_keys);
+			swap(m_values, other.m_values);
+			swap(m_searcher, other.m_searcher);
+		}
+	public:
+		iterator find(const Key& key) { return begin() + found_idx(key); }
+		const_iterator find(const Key& key) const { return begin() + found_idx(key); }
+		bool contains(const Key& key) const { return found_idx(key) != size(); }
+		size_type count(const Key& key) const { return contains(key); }
+		iterator lower_bound(const Key& key) { return begin() + lower_bound_idx(key); }
+		const_iterator lower_bound(const Key& key) const { return begin() + lower_bound_idx(key); }
+		iterator upper_bound(const Key& key) { return begin() + upper_bound_idx(key); }
+		const_iterator upper_bound(const Key& key) const { return begin() + upper_bound_idx(key); }
+
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		iterator find(const K& key) { return begin() + found_idx(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		const_iterator find(const K& key) const { return begin() + found_idx(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		bool contains(const K& key) const { return found_idx(key) != size(); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		size_type count(const K& key) const { return contains(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		iterator lower_bound(const K& key) { return begin() + lower_bound_idx(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		const_iterator lower_bound(const K& key) const { return begin() + lower_bound_idx(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		iterator upper_bound(const K& key) { return begin() + upper_bound_idx(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		const_iterator upper_bound(const K& key) const { return begin() + upper_bound_idx(key); }
+
+		friend bool operator==(const flat_map& lhs, const flat_map& rhs) {
+			return lhs.m_keys == rhs.m_keys && lhs.m_values == rhs.m_values;
+		}
+		friend bool operator!=(const flat_map& lhs, const flat_map& rhs) {
+			return !(lhs == rhs);
+		}
+	private:
+		template <class K>
+		size_t lower_bound_idx(const K& key) const {
+			return m_searcher.lower_bound(std::data(m_keys), m_keys.size(), key, m_comp);
+		}
+		template <class K>
+		size_t upper_bound_idx(const K& key) const {
+			return static_cast<size_t>(std::upper_bound(m_keys.begin(), m_keys.end(), key, m_comp) - m_keys.begin());
+		}
+		template <class K>
+		size_t found_idx(const K& key) const {									//size() if not found
+			const size_t idx{ lower_bound_idx(key) };
+			return idx != m_keys.size() && !m_comp(key, m_keys[idx]) ? idx : m_keys.size();
+		}
+		size_t checked_idx(const Key& key) const {
+			const size_t idx{ found_idx(key) };
+			if (idx == m_keys.size()) {
+				throw std::out_of_range("Key not found");
+			}
+			return idx;
+		}
+		size_t hinted_idx(const_iterator hint, const Key& key) const {			//The hint is right if the key belongs just before it
+			const auto where{ hint.m_key };
+			const bool after_prev{ where == m_keys.cbegin() || m_comp(*std::prev(where), key) },
+				before_hint{ where == m_keys.cend() || !m_comp(*where, key) };
+			return after_prev && before_hint ? static_cast<size_t>(where - m_keys.cbegin()) : lower_bound_idx(key);
+		}
+
+		template <class K, class... Types>
+		std::pair<iterator, bool> emplace_at(size_t idx, K&& key, Types&&... args) {
+			if (idx != m_keys.size() && !m_comp(key, m_keys[idx])) {
+				return { begin() + idx, false };
+			}
+			const auto offset{ static_cast<difference_type>(idx) };
+			m_keys.insert(m_keys.begin() + offset, Key(std::forward<K>(key)));
+			try {
+				m_values.emplace(m_values.begin() + offset, std::forward<Types>(args)...);
+			}
+			catch (...) {
+				m_keys.erase(m_keys.begin() + offset);
+				throw;
+			}
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+			return { begin() + offset, true };
+		}
+
+		template <class Pair>
+		void append_unsorted(Pair&& value) {									//Moves only out of an rvalue: std::get keeps the value category
+			m_keys.push_back(std::get<0>(std::forward<Pair>(value)));
+			m_values.push_back(std::get<1>(std::forward<Pair>(value)));
+		}
+
+		void sort_unique(size_t sorted_size) {									//[0, sorted_size) is sorted and unique, the rest isn't.
+			const size_t count{ m_keys.size() };								//The keys are sorted by a permutation, then both arrays
+			std::vector<size_t> order(count);									//are rebuilt in a single pass, skipping duplicates
+			for (size_t idx = 0; idx < count; ++idx) {
+				order[idx] = idx;
+			}
+			const auto by_key{ [this](size_t lhs, size_t rhs) { return m_comp(m_keys[lhs], m_keys[rhs]); } };
+			const auto middle{ order.begin() + static_cast<difference_type>(sorted_size) };
+			std::stable_sort(middle, order.end(), by_key);
+			std::inplace_merge(order.begin(), middle, order.end(), by_key);	//Stable: the elements already present go first and survive
+
+			KeyContainer keys;
+			MappedContainer values;
+			keys.reserve(count);
+			values.reserve(count);
+			for (const size_t idx : order) {
+				if (keys.empty() || m_comp(keys.back(), m_keys[idx])) {
+					keys.push_back(std::move(m_keys[idx]));
+					values.push_back(std::move(m_values[idx]));
+				}
+			}
+			m_keys = std::move(keys);
+			m_values = std::move(values);
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+		}
+	private:
+		Compare m_comp;
+		KeyContainer m_keys;
+		MappedContainer m_values;
+		searcher_type m_searcher;
+	};
+
+	template <class Key, class Ty, class Compare, class Search, class KeyContainer, class MappedContainer>
+	void swap(flat_map<Key, Ty, Compare, Search, KeyContainer, MappedContainer>& lhs,
+		flat_map<Key, Ty, Compare, Search, KeyContainer, MappedContainer>& rhs) noexcept {
+		lhs.swap(rhs);
+	}
+}
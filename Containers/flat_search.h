@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+
+namespace utility::container::search {											//Lookup policies of flat_set and flat_map
+	struct binary {																//std::lower_bound
+		template <class Key, class Compare>
+		class searcher {
+		public:
+			void rebuild(const Key*, size_t) {
+			}
+			template <class K>
+			size_t lower_bound(const Key* keys, size_t count, const K& key, const Compare& comp) const {
+				return static_cast<size_t>(std::lower_bound(keys, keys + count, key, comp) - keys);
+			}
+		};
+	};
+
+	struct branchless {															//The halving step is a conditional move instead of a mispredicted jump
+		template <class Key, class Compare>
+		class searcher {
+		public:
+			void rebuild(const Key*, size_t) {
+			}
+			template <class K>
+			size_t lower_bound(const Key* keys, size_t count, const K& key, const Compare& comp) const {
+				if (!count) {
+					return 0;
+				}
+				const Key* base{ keys };
+				while (count > 1) {
+					const size_t half{ count / 2 };
+					base = comp(base[half], key) ? base + half : base;
+					count -= half;
+				}
+				return static_cast<size_t>(base - keys) + comp(*base, key);
+			}
+		};
+	};
+
+	struct eytzinger {															//A copy of the keys in the breadth-first order of a binary search tree:
+		template <class Key, class Compare>										//the top levels share a few cache lines and the next ones can be prefetched.
+		class searcher {														//The copy is rebuilt on every modification, so it suits read-mostly tables
+		public:
+			void rebuild(const Key* keys, size_t count) {
+				m_layout.clear();
+				m_rank.clear();
+				if (!count) {
+					return;
+				}
+				m_layout.assign(keys, keys + count);
+				m_rank.resize(count + 1);
+				size_t sorted_idx{ 0 };
+				fill(keys, sorted_idx, 1);
+			}
+			template <class K>
+			size_t lower_bound(const Key*, size_t count, const K& key, const Compare& comp) const {
+				size_t node{ 1 };
+				while (node <= count) {
+					node = 2 * node + comp(m_layout[node - 1], key);
+				}
+				while (node & 1) {												//Climbs up to the last node where the search went left
+					node >>= 1;
+				}
+				node >>= 1;
+				return node ? m_rank[node] : count;							//None of the keys is less: the end
+			}
+		private:
+			void fill(const Key* keys, size_t& sorted_idx, size_t node) {		//In-order traversal of the implicit tree
+				if (node > m_layout.size()) {
+					return;
+				}
+				fill(keys, sorted_idx, 2 * node);
+				m_layout[node - 1] = keys[sorted_idx];
+				m_rank[node] = sorted_idx++;
+				fill(keys, sorted_idx, 2 * node + 1);
+			}
+		private:
+			std::vector<Key> m_layout;											//Node k is at k - 1, its children are 2k and 2k + 1
+			std::vector<size_t> m_rank;											//Index of node's key in the sorted array
+		};
+	};
+}
+
+namespace utility::container::details {
+	template <class Compare, class K, class = void>
+	struct is_lookup_key															//Heterogeneous lookup needs Compare::is_transparent
+		: std::false_type {};
+
+	template <class Compare, class K>
+	struct is_lookup_key<Compare, K, std::void_t<typename Compare::is_transparent>>
+		: std::true_type {};
+
+	template <class Compare, class K>
+	inline constexpr bool is_lookup_key_v = is_lookup_key<Compare, K>::value;
+}
@@ -0,0 +1,224 @@
+#pragma once
+#include "flat_search.h"
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <initializer_list>
+
+namespace utility::container {
+	template <class Key, class Compare = std::less<Key>, class Search = search::binary, class KeyContainer = std::vector<Key>>
+	class flat_set {															//Sorted unique keys in a contiguous array: a lookup touches
+	public:																		//a few adjacent cache lines instead of a chain of tree nodes
+		using key_type = Key;
+		using value_type = Key;
+		using key_compare = Compare;
+		using value_compare = Compare;
+		using container_type = KeyContainer;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = const Key&;
+		using const_reference = const Key&;
+		using iterator = typename KeyContainer::const_iterator;					//Keys can't be modified in place
+		using const_iterator = iterator;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = reverse_iterator;
+	private:
+		using searcher_type = typename Search::template searcher<Key, Compare>;
+	public:
+		flat_set() = default;
+		explicit flat_set(const Compare& comp)
+			: m_comp{ comp }
+		{
+		}
+		template <class InputIt>
+		flat_set(InputIt first, InputIt last, const Compare& comp = Compare{})	//Unsorted input with duplicates: sorted, then deduplicated in one pass
+			: m_comp{ comp }
+		{
+			m_keys.assign(first, last);
+			sort_unique();
+		}
+		flat_set(std::initializer_list<Key> init, const Compare& comp = Compare{})
+			: flat_set(init.begin(), init.end(), comp)
+		{
+		}
+		explicit flat_set(KeyContainer keys, const Compare& comp = Compare{})
+			: m_comp{ comp }, m_keys(std::move(keys))
+		{
+			sort_unique();
+		}
+	public:
+		iterator begin() const noexcept { return m_keys.begin(); }
+		iterator end() const noexcept { return m_keys.end(); }
+		const_iterator cbegin() const noexcept { return begin(); }
+		const_iterator cend() const noexcept { return end(); }
+		reverse_iterator rbegin() const noexcept { return reverse_iterator(end()); }
+		reverse_iterator rend() const noexcept { return reverse_iterator(begin()); }
+
+		bool empty() const noexcept { return m_keys.empty(); }
+		size_type size() const noexcept { return m_keys.size(); }
+		size_type capacity() const noexcept { return m_keys.capacity(); }
+		void reserve(size_type count) { m_keys.reserve(count); }
+		void shrink_to_fit() { m_keys.shrink_to_fit(); }
+
+		key_compare key_comp() const { return m_comp; }
+		value_compare value_comp() const { return m_comp; }
+		const KeyContainer& keys() const noexcept { return m_keys; }
+
+		KeyContainer extract() && {												//Leaves the set empty
+			KeyContainer keys{ std::move(m_keys) };
+			clear();
+			return keys;
+		}
+
+		void clear() noexcept {
+			m_keys.clear();
+			m_searcher.rebuild(std::data(m_keys), 0);
+		}
+	public:
+		template <class... Types>
+		std::pair<iterator, bool> emplace(Types&&... args) {
+			return insert(Key(std::forward<Types>(args)...));
+		}
+		template <class... Types>
+		iterator emplace_hint(const_iterator hint, Types&&... args) {
+			return insert(hint, Key(std::forward<Types>(args)...));
+		}
+
+		std::pair<iterator, bool> insert(const Key& key) {
+			return insert_at(lower_bound_idx(key), key);
+		}
+		std::pair<iterator, bool> insert(Key&& key) {
+			return insert_at(lower_bound_idx(key), std::move(key));
+		}
+		iterator insert(const_iterator hint, const Key& key) {
+			return insert_at(hinted_idx(hint, key), key).first;
+		}
+		iterator insert(const_iterator hint, Key&& key) {
+			return insert_at(hinted_idx(hint, key), std::move(key)).first;
+		}
+		template <class InputIt>
+		void insert(InputIt first, InputIt last) {								//The new keys are sorted separately and merged in: O(n + m log m)
+			const size_t old_size{ m_keys.size() };
+			m_keys.insert(m_keys.end(), first, last);
+			merge_tail(old_size);
+		}
+		void insert(std::initializer_list<Key> init) {
+			insert(init.begin(), init.end());
+		}
+
+		iterator erase(const_iterator where) {
+			const auto next{ m_keys.erase(where) };
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+			return next;
+		}
+		iterator erase(const_iterator first, const_iterator last) {
+			const auto next{ m_keys.erase(first, last) };
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+			return next;
+		}
+		size_type erase(const Key& key) {
+			const auto where{ find(key) };
+			if (where == end()) {
+				return 0;
+			}
+			erase(where);
+			return 1;
+		}
+
+		void swap(flat_set& other) noexcept {
+			using std::swap;
+			swap(m_comp, other.m_comp);
+			swap(m_keys, other.m_keys);
+			swap(m_searcher, other.m_searcher);
+		}
+	public:
+		iterator find(const Key& key) const { return find_impl(key); }
+		bool contains(const Key& key) const { return find(key) != end(); }
+		size_type count(const Key& key) const { return contains(key); }
+		iterator lower_bound(const Key& key) const { return begin() + lower_bound_idx(key); }
+		iterator upper_bound(const Key& key) const { return std::upper_bound(begin(), end(), key, m_comp); }
+		std::pair<iterator, iterator> equal_range(const Key& key) const { return equal_range_impl(key); }
+
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		iterator find(const K& key) const { return find_impl(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		bool contains(const K& key) const { return find(key) != end(); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		size_type count(const K& key) const { return contains(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		iterator lower_bound(const K& key) const { return begin() + lower_bound_idx(key); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		iterator upper_bound(const K& key) const { return std::upper_bound(begin(), end(), key, m_comp); }
+		template <class K, class = std::enable_if_t<details::is_lookup_key_v<Compare, K>>>
+		std::pair<iterator, iterator> equal_range(const K& key) const { return equal_range_impl(key); }
+
+		friend bool operator==(const flat_set& lhs, const flat_set& rhs) {
+			return lhs.m_keys == rhs.m_keys;
+		}
+		friend bool operator!=(const flat_set& lhs, const flat_set& rhs) {
+			return !(lhs == rhs);
+		}
+	private:
+		template <class K>
+		iterator find_impl(const K& key) const {
+			const size_t idx{ lower_bound_idx(key) };
+			return idx != m_keys.size() && !m_comp(key, m_keys[idx]) ? begin() + idx : end();
+		}
+		template <class K>
+		std::pair<iterator, iterator> equal_range_impl(const K& key) const {
+			const auto first{ find_impl(key) };
+			return { first, first == end() ? first : std::next(first) };
+		}
+		template <class K>
+		size_t lower_bound_idx(const K& key) const {
+			return m_searcher.lower_bound(std::data(m_keys), m_keys.size(), key, m_comp);
+		}
+		size_t hinted_idx(const_iterator hint, const Key& key) const {			//The hint is right if the key belongs just before it
+			const bool after_prev{ hint == begin() || m_comp(*std::prev(hint), key) },
+				before_hint{ hint == end() || !m_comp(*hint, key) };
+			return after_prev && before_hint ? static_cast<size_t>(hint - begin()) : lower_bound_idx(key);
+		}
+
+		template <class Ty>
+		std::pair<iterator, bool> insert_at(size_t idx, Ty&& key) {
+			if (idx != m_keys.size() && !m_comp(key, m_keys[idx])) {
+				return { begin() + idx, false };
+			}
+			m_keys.insert(m_keys.begin() + idx, std::forward<Ty>(key));
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+			return { begin() + idx, true };
+		}
+
+		void sort_unique() {
+			std::stable_sort(m_keys.begin(), m_keys.end(), m_comp);			//Stable: the first of equal keys is kept
+			m_keys.erase(std::unique(m_keys.begin(), m_keys.end(), equivalent()), m_keys.end());
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+		}
+		void merge_tail(size_t old_size) {										//[0, old_size) is sorted and unique, the rest isn't
+			const auto middle{ m_keys.begin() + static_cast<difference_type>(old_size) };
+			std::stable_sort(middle, m_keys.end(), m_comp);
+			std::inplace_merge(m_keys.begin(), middle, m_keys.end(), m_comp);	//Stable: the keys already present go first and survive
+			m_keys.erase(std::unique(m_keys.begin(), m_keys.end(), equivalent()), m_keys.end());
+			m_searcher.rebuild(std::data(m_keys), m_keys.size());
+		}
+		auto equivalent() const {
+			return [this](const Key& lhs, const Key& rhs) {
+				return !m_comp(lhs, rhs);										//lhs <= rhs in a sorted range
+			};
+		}
+	private:
+		Compare m_comp;
+		KeyContainer m_keys;
+		searcher_type m_searcher;
+	};
+
+	template <class Key, class Compare, class Search, class KeyContainer>
+	void swap(flat_set<Key, Compare, Search, KeyContainer>& lhs, flat_set<Key, Compare, Search, KeyContainer>& rhs) noexcept {
+		lhs.swap(rhs);
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <new>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+namespace utility::container {
+	inline constexpr size_t CACHE_LINE_SIZE{ 64 };								//std::hardware_destructive_interference_size isn't available everywhere
+
+	/*********************************************************************
+	Bounded multi-producer multi-consumer ring buffer (D. Vyukov's
+	algorithm). Every cell carries a sequence number telling whose turn it
+	is: a producer claims a position with one CAS on the enqueue counter,
+	constructs the element in place and publishes it with a release store
+	of the sequence; consumers do the same on their own counter. The cells
+	are allocated once; elements are constructed on push and destroyed on
+	pop, so Ty needn't be default-constructible.
+	A claimed cell must be published whatever happens, or the queue stalls
+	at it: an element is built outside the cell if its constructor may
+	throw and moved in, hence Ty must be nothrow move-constructible; a
+	throwing move-assignment in try_pop() loses the element but frees the
+	cell
+	*********************************************************************/
+	template <class Ty, class Allocator = std::allocator<Ty>>
+	class mpmc_queue {
+		static_assert(std::is_nothrow_move_constructible_v<Ty>, "mpmc_queue needs a nothrow move constructor");
+	public:
+		using value_type = Ty;
+		using allocator_type = Allocator;
+		using size_type = size_t;
+	private:
+		struct cell_type {
+			std::atomic<size_t> sequence;
+			alignas(Ty) unsigned char storage[sizeof(Ty)];
+
+			Ty* value() noexcept { return std::launder(reinterpret_cast<Ty*>(storage)); }
+		};
+
+		using cell_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<cell_type>;
+		using cell_traits = std::allocator_traits<cell_allocator>;
+	public:
+		explicit mpmc_queue(size_t capacity, const Allocator& alloc = Allocator{})	//Rounded up to a power of two
+			: m_alloc(alloc),
+			m_capacity{ round_up_to_power_of_two(capacity) },
+			m_mask{ m_capacity - 1 },
+			m_cells{ cell_traits::allocate(m_alloc, m_capacity) }
+		{
+			for (size_t idx = 0; idx < m_capacity; ++idx) {
+				::new (static_cast<void*>(m_cells + idx)) cell_type;
+				m_cells[idx].sequence.store(idx, std::memory_order_relaxed);
+			}
+		}
+		mpmc_queue(const mpmc_queue&) = delete;
+		mpmc_queue& operator=(const mpmc_queue&) = delete;
+		~mpmc_queue() {
+			while (try_pop_impl([](Ty*) {})) {
+			}
+			for (size_t idx = 0; idx < m_capacity; ++idx) {
+				m_cells[idx].~cell_type();
+			}
+			cell_traits::deallocate(m_alloc, m_cells, m_capacity);
+		}
+	public:
+		template <class... Types>
+		bool try_emplace(Types&&... args) noexcept(std::is_nothrow_constructible_v<Ty, Types&&...>) {	//False if full
+			if constexpr (!std::is_nothrow_constructible_v<Ty, Types&&...>) {
+				return try_emplace(Ty(std::forward<Types>(args)...));			//Throws before a cell is claimed
+			}
+			size_t position{ m_enqueue_pos.load(std::memory_order_relaxed) };
+			for (;;) {
+				cell_type& cell{ m_cells[position & m_mask] };
+				const size_t sequence{ cell.sequence.load(std::memory_order_acquire) };
+				const auto diff{ static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position) };
+				if (diff == 0) {
+					if (m_enqueue_pos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						::new (static_cast<void*>(cell.storage)) Ty(std::forward<Types>(args)...);
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0) {
+					return false;
+				}
+				else {
+					position = m_enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+		bool try_push(const Ty& value) noexcept(std::is_nothrow_copy_constructible_v<Ty>) {
+			return try_emplace(value);
+		}
+		bool try_push(Ty&& value) noexcept(std::is_nothrow_move_constructible_v<Ty>) {
+			return try_emplace(std::move(value));
+		}
+		bool try_pop(Ty& value) noexcept(std::is_nothrow_move_assignable_v<Ty>) {	//False if empty
+			return try_pop_impl([&value](Ty* stored) { value = std::move(*stored); });
+		}
+
+		size_t size_approx() const noexcept {									//Exact if nobody modifies the queue
+			const size_t dequeue_pos{ m_dequeue_pos.load(std::memory_order_acquire) },
+				enqueue_pos{ m_enqueue_pos.load(std::memory_order_acquire) };
+			return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+		}
+		bool empty() const noexcept { return size_approx() == 0; }
+		bool full() const noexcept { return size_approx() >= m_capacity; }
+		size_t capacity() const noexcept { return m_capacity; }
+		allocator_type get_allocator() const { return allocator_type(m_alloc); }
+	private:
+		template <class Consumer>
+		bool try_pop_impl(Consumer&& consume) {
+			size_t position{ m_dequeue_pos.load(std::memory_order_relaxed) };
+			for (;;) {
+				cell_type& cell{ m_cells[position & m_mask] };
+				const size_t sequence{ cell.sequence.load(std::memory_order_acquire) };
+				const auto diff{ static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1) };
+				if (diff == 0) {
+					if (m_dequeue_pos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						Ty* stored{ cell.value() };
+						try {
+							consume(stored);
+						}
+						catch (...) {
+							release(cell, stored, position);
+							throw;
+						}
+						release(cell, stored, position);
+						return true;
+					}
+				}
+				else if (diff < 0) {
+					return false;
+				}
+				else {
+					position = m_dequeue_pos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void release(cell_type& cell, Ty* stored, size_t position) noexcept {	//Hands the cell over to the producers
+			stored->~Ty();
+			cell.sequence.store(position + m_capacity, std::memory_order_release);
+		}
+
+		static size_t round_up_to_power_of_two(size_t value) noexcept {
+			size_t power{ 2 };
+			while (power < value) {
+				power <<= 1;
+			}
+			return power;
+		}
+	private:
+		cell_allocator m_alloc;
+		const size_t m_capacity,
+			m_mask;
+		cell_type* m_cells;
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueue_pos{ 0 };		//Producers and consumers don't share a cache line
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeue_pos{ 0 };
+	};
+}
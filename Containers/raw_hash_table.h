@@ -0,0 +1,637 @@
+#pragma once
+#include <new>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <initializer_list>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UTILITY_CONTAINER_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace utility::container::details {
+	using ctrl_t = int8_t;															//Control byte of a slot: the low 7 bits of the hash if it's occupied
+
+	inline constexpr ctrl_t CTRL_EMPTY{ -128 },
+							CTRL_DELETED{ -2 },										//A tombstone: lookups go on past it
+							CTRL_SENTINEL{ -1 };									//Past the last slot, stops the iterators
+
+	inline constexpr size_t GROUP_WIDTH{ 16 };										//Slots whose control bytes are matched at once
+
+	struct alignas(GROUP_WIDTH) ctrl_group {										//Storage of the control bytes
+		ctrl_t bytes[GROUP_WIDTH];
+	};
+
+	inline uint32_t lowest_bit_idx(uint32_t mask) noexcept {						//mask != 0
+#ifdef _MSC_VER
+		unsigned long idx;
+		_BitScanForward(&idx, mask);
+		return idx;
+#else
+		return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+	}
+
+	class Group {																	//GROUP_WIDTH control bytes starting at a multiple of GROUP_WIDTH
+	public:
+		explicit Group(const ctrl_t* ctrl) noexcept
+#ifdef UTILITY_CONTAINER_HASH_SSE2
+			: m_ctrl{ _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl)) }
+#else
+			: m_ctrl{ ctrl }
+#endif
+		{
+		}
+	public:																			//Bit i of a mask stands for the slot i
+		uint32_t match(ctrl_t h2) const noexcept {
+#ifdef UTILITY_CONTAINER_HASH_SSE2
+			return movemask(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl));
+#else
+			return match_if([h2](ctrl_t ctrl) { return ctrl == h2; });
+#endif
+		}
+		uint32_t match_empty() const noexcept {
+#ifdef UTILITY_CONTAINER_HASH_SSE2
+			return movemask(_mm_cmpeq_epi8(_mm_set1_epi8(CTRL_EMPTY), m_ctrl));
+#else
+			return match_if([](ctrl_t ctrl) { return ctrl == CTRL_EMPTY; });
+#endif
+		}
+		uint32_t match_free() const noexcept {										//Empty or deleted
+#ifdef UTILITY_CONTAINER_HASH_SSE2
+			return movemask(_mm_cmpgt_epi8(_mm_set1_epi8(CTRL_SENTINEL), m_ctrl));
+#else
+			return match_if([](ctrl_t ctrl) { return ctrl < CTRL_SENTINEL; });
+#endif
+		}
+	private:
+#ifdef UTILITY_CONTAINER_HASH_SSE2
+		static uint32_t movemask(__m128i bytes) noexcept {
+			return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+		}
+#else
+		template <class Predicate>
+		uint32_t match_if(Predicate pred) const noexcept {
+			uint32_t mask{ 0 };
+			for (size_t idx = 0; idx < GROUP_WIDTH; ++idx) {
+				mask |= static_cast<uint32_t>(pred(m_ctrl[idx])) << idx;
+			}
+			return mask;
+		}
+#endif
+	private:
+#ifdef UTILITY_CONTAINER_HASH_SSE2
+		__m128i m_ctrl;
+#else
+		const ctrl_t* m_ctrl;
+#endif
+	};
+
+	template <class Key>
+	struct set_policy {
+		using key_type = Key;
+		using value_type = Key;
+		using storage_type = Key;
+
+		static const Key& key(const value_type& value) noexcept { return value; }
+	};
+
+	template <class Key, class Ty>
+	struct map_policy {
+		using key_type = Key;
+		using value_type = std::pair<const Key, Ty>;
+		using storage_type = std::pair<Key, Ty>;									//Lets rehashing move the keys
+
+		static const Key& key(const value_type& value) noexcept { return value.first; }
+	};
+
+	/*********************************************************************
+	Open addressing over a single array of slots with a parallel array of
+	control bytes. A lookup hashes the key once: the high bits pick a group
+	of GROUP_WIDTH slots, the low 7 bits are compared with all the control
+	bytes of the group in one SSE2 instruction, so the keys are compared
+	only for the likely matches. Groups are probed quadratically until a
+	group with an empty slot. The table grows at 7/8 load.
+	Allocator serves whole arrays and is rebound to the slot and control
+	types, so it must be copyable from a rebound copy: std::allocator,
+	pmr::polymorphic_allocator or memory::BlockPoolAllocator. The
+	single-object PoolAllocator and StaticPoolAllocator don't fit
+	*********************************************************************/
+	template <class Policy, class Hash, class KeyEqual, class Allocator>
+	class raw_hash_table {
+	public:
+		using key_type = typename Policy::key_type;
+		using value_type = typename Policy::value_type;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using hasher = Hash;
+		using key_equal = KeyEqual;
+		using allocator_type = Allocator;
+		using reference = value_type&;
+		using const_reference = const value_type&;
+		using pointer = typename std::allocator_traits<Allocator>::pointer;
+		using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
+	private:
+		using storage_type = typename Policy::storage_type;
+
+		union slot_type {															//Constructed as value_type, moved as storage_type
+			slot_type() noexcept {}
+			~slot_type() {}
+
+			value_type value;
+			storage_type storage;
+		};
+
+		using alloc_traits = std::allocator_traits<Allocator>;
+		using slot_allocator = typename alloc_traits::template rebind_alloc<slot_type>;
+		using slot_traits = typename alloc_traits::template rebind_traits<slot_type>;
+		using ctrl_allocator = typename alloc_traits::template rebind_alloc<ctrl_group>;	//Aligned for the SSE2 loads
+		using ctrl_traits = typename alloc_traits::template rebind_traits<ctrl_group>;
+
+		static_assert(std::is_constructible_v<slot_allocator, const Allocator&> && std::is_constructible_v<ctrl_allocator, const Allocator&>,
+			"Allocator must be constructible from a rebound copy and allocate arrays (e.g. BlockPoolAllocator, not PoolAllocator)");
+
+		static constexpr size_t MIN_CAPACITY{ GROUP_WIDTH },
+								NPOS{ static_cast<size_t>(-1) };
+
+		template <bool is_const>
+		class iterator_base {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = typename raw_hash_table::value_type;
+			using difference_type = std::ptrdiff_t;
+			using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+			using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+		public:
+			iterator_base() = default;
+			template <bool other_const, class = std::enable_if_t<is_const && !other_const>>
+			iterator_base(const iterator_base<other_const>& other) noexcept
+				: m_ctrl{ other.m_ctrl }, m_slot{ other.m_slot }
+			{
+			}
+		public:
+			reference operator*() const noexcept { return m_slot->value; }
+			pointer operator->() const noexcept { return std::addressof(m_slot->value); }
+
+			iterator_base& operator++() noexcept {
+				++m_ctrl;
+				++m_slot;
+				skip_free();
+				return *this;
+			}
+			iterator_base operator++(int) noexcept {
+				auto old{ *this };
+				++*this;
+				return old;
+			}
+
+			friend bool operator==(const iterator_base& lhs, const iterator_base& rhs) noexcept { return lhs.m_ctrl == rhs.m_ctrl; }
+			friend bool operator!=(const iterator_base& lhs, const iterator_base& rhs) noexcept { return lhs.m_ctrl != rhs.m_ctrl; }
+		private:
+			friend class raw_hash_table;
+			friend class iterator_base<!is_const>;
+
+			iterator_base(const ctrl_t* ctrl, slot_type* slot) noexcept
+				: m_ctrl{ ctrl }, m_slot{ slot }
+			{
+			}
+			void skip_free() noexcept {
+				while (m_ctrl && *m_ctrl < CTRL_SENTINEL) {
+					++m_ctrl;
+					++m_slot;
+				}
+			}
+		private:
+			const ctrl_t* m_ctrl{ nullptr };
+			slot_type* m_slot{ nullptr };
+		};
+	public:
+		using iterator = iterator_base<false>;
+		using const_iterator = iterator_base<true>;
+	public:
+		raw_hash_table() = default;
+		explicit raw_hash_table(size_t bucket_count, const Hash& hash = Hash{}, const KeyEqual& equal = KeyEqual{}, const Allocator& alloc = Allocator{})
+			: m_hash{ hash }, m_equal{ equal }, m_slot_alloc(alloc), m_ctrl_alloc(alloc)
+		{
+			reserve(bucket_count);
+		}
+		explicit raw_hash_table(const Allocator& alloc)
+			: m_slot_alloc(alloc), m_ctrl_alloc(alloc)
+		{
+		}
+		template <class InputIt>
+		raw_hash_table(InputIt first, InputIt last, size_t bucket_count = 0, const Hash& hash = Hash{}, const KeyEqual& equal = KeyEqual{}, const Allocator& alloc = Allocator{})
+			: raw_hash_table(bucket_count, hash, equal, alloc)
+		{
+			insert(first, last);
+		}
+		raw_hash_table(std::initializer_list<value_type> init, size_t bucket_count = 0, const Hash& hash = Hash{}, const KeyEqual& equal = KeyEqual{}, const Allocator& alloc = Allocator{})
+			: raw_hash_table(init.begin(), init.end(), bucket_count, hash, equal, alloc)
+		{
+		}
+		raw_hash_table(const raw_hash_table& other)
+			: m_hash{ other.m_hash }, m_equal{ other.m_equal },
+			m_slot_alloc(slot_traits::select_on_container_copy_construction(other.m_slot_alloc)),
+			m_ctrl_alloc(ctrl_traits::select_on_container_copy_construction(other.m_ctrl_alloc))
+		{
+			reserve(other.size());
+			for (const auto& value : other) {
+				emplace_new(value);
+			}
+		}
+		raw_hash_table(raw_hash_table&& other) noexcept
+			: m_hash{ std::move(other.m_hash) }, m_equal{ std::move(other.m_equal) },
+			m_slot_alloc(std::move(other.m_slot_alloc)), m_ctrl_alloc(std::move(other.m_ctrl_alloc)),
+			m_ctrl{ std::exchange(other.m_ctrl, nullptr) }, m_slots{ std::exchange(other.m_slots, nullptr) },
+			m_capacity{ std::exchange(other.m_capacity, 0) }, m_size{ std::exchange(other.m_size, 0) },
+			m_growth_left{ std::exchange(other.m_growth_left, 0) }
+		{
+		}
+		raw_hash_table& operator=(const raw_hash_table& other) {
+			if (this != std::addressof(other)) {
+				raw_hash_table copy(other);											//Allocators aren't propagated
+				clear();
+				reserve(copy.size());
+				for (auto& value : copy) {
+					emplace_new(std::move(value));
+				}
+				m_hash = other.m_hash;
+				m_equal = other.m_equal;
+			}
+			return *this;
+		}
+		raw_hash_table& operator=(raw_hash_table&& other) noexcept {
+			if (this != std::addressof(other)) {
+				destroy();
+				m_hash = std::move(other.m_hash);
+				m_equal = std::move(other.m_equal);
+				m_slot_alloc = std::move(other.m_slot_alloc);
+				m_ctrl_alloc = std::move(other.m_ctrl_alloc);
+				m_ctrl = std::exchange(other.m_ctrl, nullptr);
+				m_slots = std::exchange(other.m_slots, nullptr);
+				m_capacity = std::exchange(other.m_capacity, 0);
+				m_size = std::exchange(other.m_size, 0);
+				m_growth_left = std::exchange(other.m_growth_left, 0);
+			}
+			return *this;
+		}
+		~raw_hash_table() {
+			destroy();
+		}
+	public:
+		iterator begin() noexcept { return make_begin<iterator>(); }
+		iterator end() noexcept { return { m_ctrl ? m_ctrl + m_capacity : nullptr, m_slots + m_capacity }; }
+		const_iterator begin() const noexcept { return make_begin<const_iterator>(); }
+		const_iterator end() const noexcept { return { m_ctrl ? m_ctrl + m_capacity : nullptr, m_slots + m_capacity }; }
+		const_iterator cbegin() const noexcept { return begin(); }
+		const_iterator cend() const noexcept { return end(); }
+
+		bool empty() const noexcept { return !m_size; }
+		size_type size() const noexcept { return m_size; }
+		size_type capacity() const noexcept { return m_capacity; }
+		size_type bucket_count() const noexcept { return m_capacity; }
+		float load_factor() const noexcept { return m_capacity ? static_cast<float>(m_size) / m_capacity : 0.0f; }
+		float max_load_factor() const noexcept { return 7.0f / 8; }
+
+		hasher hash_function() const { return m_hash; }
+		key_equal key_eq() const { return m_equal; }
+		allocator_type get_allocator() const { return allocator_type(m_slot_alloc); }
+
+		void reserve(size_t count) {												//Room for count elements without rehashing
+			if (count > m_size + m_growth_left) {
+				rehash(capacity_for(count));
+			}
+		}
+		void rehash(size_t bucket_count) {
+			bucket_count = std::max(bucket_count, capacity_for(m_size));
+			if (bucket_count) {
+				resize(normalize_capacity(bucket_count));
+			}
+		}
+
+		void clear() noexcept {
+			if (!m_size) {
+				return;
+			}
+			for (size_t idx = 0; idx < m_capacity; ++idx) {
+				if (m_ctrl[idx] >= 0) {
+					slot_traits::destroy(m_slot_alloc, std::addressof(m_slots[idx].value));
+				}
+			}
+			std::fill(m_ctrl, m_ctrl + m_capacity, CTRL_EMPTY);
+			m_size = 0;
+			m_growth_left = growth_of(m_capacity);
+		}
+
+		void swap(raw_hash_table& other) noexcept {
+			using std::swap;
+			swap(m_hash, other.m_hash);
+			swap(m_equal, other.m_equal);
+			if constexpr (slot_traits::propagate_on_container_swap::value) {
+				swap(m_slot_alloc, other.m_slot_alloc);
+				swap(m_ctrl_alloc, other.m_ctrl_alloc);
+			}
+			swap(m_ctrl, other.m_ctrl);
+			swap(m_slots, other.m_slots);
+			swap(m_capacity, other.m_capacity);
+			swap(m_size, other.m_size);
+			swap(m_growth_left, other.m_growth_left);
+		}
+	public:
+		std::pair<iterator, bool> insert(const value_type& value) {
+			return emplace_key(Policy::key(value), value);
+		}
+		std::pair<iterator, bool> insert(value_type&& value) {
+			return emplace_key(Policy::key(value), std::move(value));
+		}
+		iterator insert(const_iterator, const value_type& value) {					//The hint is ignored
+			return insert(value).first;
+		}
+		iterator insert(const_iterator, value_type&& value) {
+			return insert(std::move(value)).first;
+		}
+		template <class InputIt>
+		void insert(InputIt first, InputIt last) {
+			if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>) {
+				reserve(m_size + static_cast<size_t>(std::distance(first, last)));	//Duplicates may overestimate it
+			}
+			for (; first != last; ++first) {
+				emplace(*first);
+			}
+		}
+		void insert(std::initializer_list<value_type> init) {
+			insert(init.begin(), init.end());
+		}
+
+		template <class... Types>
+		std::pair<iterator, bool> emplace(Types&&... args) {
+			if constexpr (sizeof...(Types) == 1 && (std::is_same_v<std::decay_t<Types>, value_type> && ...)) {
+				return emplace_key(Policy::key(args)..., std::forward<Types>(args)...);
+			}
+			else {
+				slot_type tmp;														//The key is needed before the slot is known
+				slot_traits::construct(m_slot_alloc, std::addressof(tmp.value), std::forward<Types>(args)...);
+				auto result{ emplace_key(Policy::key(tmp.value), std::move(tmp.storage)) };
+				slot_traits::destroy(m_slot_alloc, std::addressof(tmp.value));
+				return result;
+			}
+		}
+		template <class... Types>
+		iterator emplace_hint(const_iterator, Types&&... args) {
+			return emplace(std::forward<Types>(args)...).first;
+		}
+
+		iterator erase(const_iterator where) {
+			iterator next{ where.m_ctrl, where.m_slot };
+			erase_at(static_cast<size_t>(where.m_ctrl - m_ctrl));
+			next.skip_free();
+			return next;
+		}
+		iterator erase(iterator where) {
+			return erase(const_iterator{ where });
+		}
+		iterator erase(const_iterator first, const_iterator last) {
+			while (first != last) {
+				first = erase(first);
+			}
+			return { last.m_ctrl, last.m_slot };
+		}
+		size_type erase(const key_type& key) {
+			const size_t idx{ find_idx(key) };
+			if (idx == NPOS) {
+				return 0;
+			}
+			erase_at(idx);
+			return 1;
+		}
+	public:
+		iterator find(const key_type& key) { return iterator_at<iterator>(find_idx(key)); }
+		const_iterator find(const key_type& key) const { return iterator_at<const_iterator>(find_idx(key)); }
+		bool contains(const key_type& key) const { return find_idx(key) != NPOS; }
+		size_type count(const key_type& key) const { return contains(key); }
+		std::pair<iterator, iterator> equal_range(const key_type& key) {
+			const auto first{ find(key) };
+			return { first, first == end() ? first : std::next(first) };
+		}
+		std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const {
+			const auto first{ find(key) };
+			return { first, first == end() ? first : std::next(first) };
+		}
+
+		friend bool operator==(const raw_hash_table& lhs, const raw_hash_table& rhs) {
+			if (lhs.size() != rhs.size()) {
+				return false;
+			}
+			for (const auto& value : lhs) {
+				const auto where{ rhs.find(Policy::key(value)) };
+				if (where == rhs.end() || !(*where == value)) {
+					return false;
+				}
+			}
+			return true;
+		}
+		friend bool operator!=(const raw_hash_table& lhs, const raw_hash_table& rhs) {
+			return !(lhs == rhs);
+		}
+	protected:
+		template <class K, class... Types>
+		std::pair<iterator, bool> emplace_key(const K& key, Types&&... args) {		//Constructs value_type from args unless the key is present
+			const size_t hash{ mix(key) };
+			size_t idx{ find_idx(key, hash) };
+			if (idx != NPOS) {
+				return { iterator_at<iterator>(idx), false };
+			}
+			idx = prepare_insert(hash);
+			slot_traits::construct(m_slot_alloc, std::addressof(m_slots[idx].value), std::forward<Types>(args)...);
+			commit_insert(idx, hash);
+			return { iterator_at<iterator>(idx), true };
+		}
+		template <class It>
+		It iterator_at(size_t idx) const noexcept {
+			return idx == NPOS ? It{ m_ctrl ? m_ctrl + m_capacity : nullptr, m_slots + m_capacity } : It{ m_ctrl + idx, m_slots + idx };
+		}
+		template <class K>
+		size_t find_idx(const K& key) const {
+			return m_size ? find_idx(key, mix(key)) : NPOS;
+		}
+	private:
+		template <class K>
+		size_t mix(const K& key) const {											//Spreads weak hashes (e.g. the identity of integers) over all bits
+			const uint64_t hash{ static_cast<uint64_t>(m_hash(key)) * 0x9E3779B97F4A7C15ull };
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+		static ctrl_t h2(size_t hash) noexcept {
+			return static_cast<ctrl_t>(hash & 0x7F);
+		}
+		size_t first_group(size_t hash) const noexcept {
+			return (hash >> 7) & (m_capacity / GROUP_WIDTH - 1);
+		}
+		size_t next_group(size_t group, size_t step) const noexcept {				//Triangular steps visit every group
+			return (group + step) & (m_capacity / GROUP_WIDTH - 1);
+		}
+
+		template <class K>
+		size_t find_idx(const K& key, size_t hash) const {
+			if (!m_capacity) {
+				return NPOS;
+			}
+			size_t group{ first_group(hash) };
+			for (size_t step = 1;; ++step) {
+				const size_t base{ group * GROUP_WIDTH };
+				const Group ctrl(m_ctrl + base);
+				for (uint32_t mask = ctrl.match(h2(hash)); mask; mask &= mask - 1) {
+					const size_t idx{ base + lowest_bit_idx(mask) };
+					if (m_equal(Policy::key(m_slots[idx].value), key)) {
+						return idx;
+					}
+				}
+				if (ctrl.match_empty()) {
+					return NPOS;
+				}
+				group = next_group(group, step);
+			}
+		}
+		size_t find_free(size_t hash) const noexcept {
+			size_t group{ first_group(hash) };
+			for (size_t step = 1;; ++step) {
+				const size_t base{ group * GROUP_WIDTH };
+				if (const uint32_t mask = Group(m_ctrl + base).match_free(); mask) {
+					return base + lowest_bit_idx(mask);
+				}
+				group = next_group(group, step);
+			}
+		}
+		size_t prepare_insert(size_t hash) {
+			size_t idx{ m_capacity ? find_free(hash) : NPOS };
+			if (idx == NPOS || (!m_growth_left && m_ctrl[idx] == CTRL_EMPTY)) {		//A tombstone can be reused even at full load
+				grow();
+				idx = find_free(hash);
+			}
+			return idx;
+		}
+		void commit_insert(size_t idx, size_t hash) noexcept {
+			m_growth_left -= m_ctrl[idx] == CTRL_EMPTY;
+			m_ctrl[idx] = h2(hash);
+			++m_size;
+		}
+		void erase_at(size_t idx) noexcept {
+			slot_traits::destroy(m_slot_alloc, std::addressof(m_slots[idx].value));
+			const size_t base{ idx / GROUP_WIDTH * GROUP_WIDTH };
+			if (Group(m_ctrl + base).match_empty()) {								//Lookups stop at this group anyway
+				m_ctrl[idx] = CTRL_EMPTY;
+				++m_growth_left;
+			}
+			else {
+				m_ctrl[idx] = CTRL_DELETED;
+			}
+			--m_size;
+		}
+
+		void grow() {
+			if (m_capacity && m_size <= growth_of(m_capacity) / 2) {				//Mostly tombstones: cleaned up in place
+				resize(m_capacity);
+			}
+			else {
+				resize(m_capacity ? m_capacity * 2 : MIN_CAPACITY);
+			}
+		}
+		void resize(size_t new_capacity) {
+			ctrl_t* old_ctrl{ m_ctrl };
+			slot_type* old_slots{ m_slots };
+			const size_t old_capacity{ m_capacity };
+
+			const size_t group_count{ new_capacity / GROUP_WIDTH };
+			ctrl_group* groups{ ctrl_traits::allocate(m_ctrl_alloc, group_count + 1) };	//One more for the sentinel
+			try {
+				m_slots = slot_traits::allocate(m_slot_alloc, new_capacity);
+			}
+			catch (...) {
+				ctrl_traits::deallocate(m_ctrl_alloc, groups, group_count + 1);
+				m_slots = old_slots;
+				throw;
+			}
+			m_ctrl = reinterpret_cast<ctrl_t*>(groups);
+			std::fill(m_ctrl, m_ctrl + new_capacity, CTRL_EMPTY);
+			std::fill(m_ctrl + new_capacity, m_ctrl + new_capacity + GROUP_WIDTH, CTRL_SENTINEL);
+			m_capacity = new_capacity;
+			m_growth_left = growth_of(new_capacity) - m_size;
+
+			for (size_t idx = 0; idx < old_capacity; ++idx) {
+				if (old_ctrl[idx] >= 0) {
+					auto& old_slot{ old_slots[idx] };
+					const size_t hash{ mix(Policy::key(old_slot.value)) },
+						new_idx{ find_free(hash) };
+					slot_traits::construct(m_slot_alloc, std::addressof(m_slots[new_idx].storage), std::move(old_slot.storage));
+					slot_traits::destroy(m_slot_alloc, std::addressof(old_slot.value));
+					m_ctrl[new_idx] = h2(hash);
+				}
+			}
+			if (old_capacity) {
+				deallocate(old_ctrl, old_slots, old_capacity);
+			}
+		}
+		template <class Ty>
+		void emplace_new(Ty&& value) {												//The key is known to be absent
+			const size_t hash{ mix(Policy::key(value)) },
+				idx{ prepare_insert(hash) };
+			slot_traits::construct(m_slot_alloc, std::addressof(m_slots[idx].value), std::forward<Ty>(value));
+			commit_insert(idx, hash);
+		}
+
+		void destroy() noexcept {
+			if (m_capacity) {
+				clear();
+				deallocate(m_ctrl, m_slots, m_capacity);
+				m_ctrl = nullptr;
+				m_slots = nullptr;
+				m_capacity = 0;
+				m_growth_left = 0;
+			}
+		}
+		void deallocate(ctrl_t* ctrl, slot_type* slots, size_t capacity) noexcept {
+			ctrl_traits::deallocate(m_ctrl_alloc, reinterpret_cast<ctrl_group*>(ctrl), capacity / GROUP_WIDTH + 1);
+			slot_traits::deallocate(m_slot_alloc, slots, capacity);
+		}
+
+		template <class It>
+		It make_begin() const noexcept {
+			It first{ m_ctrl, m_slots };
+			first.skip_free();
+			return first;
+		}
+
+		static constexpr size_t growth_of(size_t capacity) noexcept {
+			return capacity - capacity / 8;
+		}
+		static constexpr size_t capacity_for(size_t count) noexcept {				//Smallest capacity holding count elements
+			return count ? count + (count + 6) / 7 : 0;
+		}
+		static size_t normalize_capacity(size_t capacity) noexcept {				//A power of two, whole groups
+			size_t normalized{ MIN_CAPACITY };
+			while (normalized < capacity) {
+				normalized *= 2;
+			}
+			return normalized;
+		}
+	private:
+		Hash m_hash;
+		KeyEqual m_equal;
+		slot_allocator m_slot_alloc;
+		ctrl_allocator m_ctrl_alloc;
+		ctrl_t* m_ctrl{ nullptr };													//m_capacity bytes followed by a group of sentinels
+		slot_type* m_slots{ nullptr };
+		size_t m_capacity{ 0 },
+			m_size{ 0 },
+			m_growth_left{ 0 };														//Inserts into empty slots before the table grows
+	};
+}
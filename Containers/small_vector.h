@@ -0,0 +1,404 @@
+#pragma once
+#include <new>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+
+namespace utility::container {
+	/*********************************************************************
+	A vector keeping up to inline_capacity elements inside itself, like
+	StaticPoolAllocator keeps its blocks, and moving to the heap beyond
+	that. Unlike the allocator's storage, the inline buffer is never
+	zero-initialized: only the constructed elements are touched.
+	Iterators and references are invalidated by a move as well
+	*********************************************************************/
+	template <class Ty, size_t inline_capacity, class Allocator = std::allocator<Ty>>
+	class small_vector {
+	public:
+		using value_type = Ty;
+		using allocator_type = Allocator;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using reference = Ty&;
+		using const_reference = const Ty&;
+		using pointer = Ty*;
+		using const_pointer = const Ty*;
+		using iterator = Ty*;
+		using const_iterator = const Ty*;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	private:
+		using alloc_traits = std::allocator_traits<Allocator>;
+
+		template <class InputIt>
+		using enable_if_iterator_t = std::enable_if_t<
+			std::is_base_of_v<std::input_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>>;
+
+		template <class InputIt>
+		static constexpr bool is_forward_v{
+			std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category> };
+	public:
+		small_vector() noexcept(std::is_nothrow_default_constructible_v<Allocator>) {	//User-provided: value-initialization (small_vector{},
+		}																		//vector<small_vector>(n)) would zero the inline buffer otherwise
+		explicit small_vector(const Allocator& alloc) noexcept
+			: m_alloc(alloc)
+		{
+		}
+		explicit small_vector(size_t count, const Allocator& alloc = Allocator{})
+			: m_alloc(alloc)
+		{
+			resize(count);
+		}
+		small_vector(size_t count, const Ty& value, const Allocator& alloc = Allocator{})
+			: m_alloc(alloc)
+		{
+			resize(count, value);
+		}
+		template <class InputIt, class = enable_if_iterator_t<InputIt>>
+		small_vector(InputIt first, InputIt last, const Allocator& alloc = Allocator{})
+			: m_alloc(alloc)
+		{
+			append(first, last);
+		}
+		small_vector(std::initializer_list<Ty> init, const Allocator& alloc = Allocator{})
+			: small_vector(init.begin(), init.end(), alloc)
+		{
+		}
+		small_vector(const small_vector& other)
+			: m_alloc(alloc_traits::select_on_container_copy_construction(other.m_alloc))
+		{
+			append(other.begin(), other.end());
+		}
+		small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible_v<Ty>)
+			: m_alloc(std::move(other.m_alloc))
+		{
+			take(std::move(other));
+		}
+		small_vector& operator=(const small_vector& other) {
+			if (this != std::addressof(other)) {
+				if constexpr (alloc_traits::propagate_on_container_copy_assignment::value) {
+					if (m_alloc != other.m_alloc) {
+						release();
+					}
+					m_alloc = other.m_alloc;
+				}
+				assign(other.begin(), other.end());
+			}
+			return *this;
+		}
+		small_vector& operator=(small_vector&& other) noexcept(std::is_nothrow_move_constructible_v<Ty>) {
+			if (this != std::addressof(other)) {
+				release();
+				if constexpr (alloc_traits::propagate_on_container_move_assignment::value) {
+					m_alloc = std::move(other.m_alloc);
+				}
+				take(std::move(other));
+			}
+			return *this;
+		}
+		small_vector& operator=(std::initializer_list<Ty> init) {
+			assign(init.begin(), init.end());
+			return *this;
+		}
+		~small_vector() {
+			release();
+		}
+	public:
+		iterator begin() noexcept { return m_data; }
+		iterator end() noexcept { return m_data + m_size; }
+		const_iterator begin() const noexcept { return m_data; }
+		const_iterator end() const noexcept { return m_data + m_size; }
+		const_iterator cbegin() const noexcept { return begin(); }
+		const_iterator cend() const noexcept { return end(); }
+		reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+		reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+		const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+		const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+		Ty* data() noexcept { return m_data; }
+		const Ty* data() const noexcept { return m_data; }
+		Ty& operator[](size_t idx) noexcept { return m_data[idx]; }
+		const Ty& operator[](size_t idx) const noexcept { return m_data[idx]; }
+		Ty& at(size_t idx) { verify_idx(idx); return m_data[idx]; }
+		const Ty& at(size_t idx) const { verify_idx(idx); return m_data[idx]; }
+		Ty& front() noexcept { return m_data[0]; }
+		const Ty& front() const noexcept { return m_data[0]; }
+		Ty& back() noexcept { return m_data[m_size - 1]; }
+		const Ty& back() const noexcept { return m_data[m_size - 1]; }
+
+		bool empty() const noexcept { return !m_size; }
+		size_type size() const noexcept { return m_size; }
+		size_type capacity() const noexcept { return m_capacity; }
+		size_type max_size() const noexcept { return alloc_traits::max_size(m_alloc); }
+		bool is_inline() const noexcept { return m_data == inline_data(); }			//The heap isn't used
+		allocator_type get_allocator() const { return m_alloc; }
+
+		void reserve(size_t count) {
+			if (count > m_capacity) {
+				reallocate(count);
+			}
+		}
+		void shrink_to_fit() {														//Back to the inline buffer if the elements fit
+			if (!is_inline() && m_size < m_capacity) {
+				reallocate(m_size);
+			}
+		}
+	public:
+		template <class... Types>
+		Ty& emplace_back(Types&&... args) {
+			if (m_size == m_capacity) {
+				return grow_emplace_back(std::forward<Types>(args)...);
+			}
+			alloc_traits::construct(m_alloc, m_data + m_size, std::forward<Types>(args)...);
+			return m_data[m_size++];
+		}
+		void push_back(const Ty& value) {
+			emplace_back(value);
+		}
+		void push_back(Ty&& value) {
+			emplace_back(std::move(value));
+		}
+		void pop_back() noexcept {
+			alloc_traits::destroy(m_alloc, m_data + --m_size);
+		}
+
+		template <class... Types>
+		iterator emplace(const_iterator where, Types&&... args) {					//Appended, then rotated into place
+			const auto offset{ where - begin() };
+			emplace_back(std::forward<Types>(args)...);
+			std::rotate(begin() + offset, end() - 1, end());
+			return begin() + offset;
+		}
+		iterator insert(const_iterator where, const Ty& value) {
+			return emplace(where, value);
+		}
+		iterator insert(const_iterator where, Ty&& value) {
+			return emplace(where, std::move(value));
+		}
+		iterator insert(const_iterator where, size_t count, const Ty& value) {
+			const auto offset{ where - begin() };
+			const size_t old_size{ m_size };
+			resize(m_size + count, value);
+			std::rotate(begin() + offset, begin() + old_size, end());
+			return begin() + offset;
+		}
+		template <class InputIt, class = enable_if_iterator_t<InputIt>>
+		iterator insert(const_iterator where, InputIt first, InputIt last) {
+			const auto offset{ where - begin() };
+			const size_t old_size{ m_size };
+			append(first, last);
+			std::rotate(begin() + offset, begin() + old_size, end());
+			return begin() + offset;
+		}
+		iterator insert(const_iterator where, std::initializer_list<Ty> init) {
+			return insert(where, init.begin(), init.end());
+		}
+
+		iterator erase(const_iterator where) {
+			return erase(where, where + 1);
+		}
+		iterator erase(const_iterator first, const_iterator last) {
+			const auto offset{ first - begin() };
+			if (first != last) {
+				iterator new_end{ std::move(begin() + (last - begin()), end(), begin() + offset) };
+				destroy_tail(static_cast<size_t>(new_end - begin()));
+			}
+			return begin() + offset;
+		}
+
+		void resize(size_t count) {
+			resize_impl(count);
+		}
+		void resize(size_t count, const Ty& value) {
+			if (count > m_capacity) {
+				const Ty copy(value);												//value may be an element
+				resize_impl(count, copy);
+			}
+			else {
+				resize_impl(count, value);
+			}
+		}
+		void clear() noexcept {
+			destroy_tail(0);
+		}
+
+		template <class InputIt, class = enable_if_iterator_t<InputIt>>
+		void assign(InputIt first, InputIt last) {
+			clear();
+			append(first, last);
+		}
+		void assign(size_t count, const Ty& value) {
+			clear();
+			resize(count, value);
+		}
+		void assign(std::initializer_list<Ty> init) {
+			assign(init.begin(), init.end());
+		}
+
+		void swap(small_vector& other) noexcept(std::is_nothrow_move_constructible_v<Ty>) {
+			if (!is_inline() && !other.is_inline()) {
+				using std::swap;
+				if constexpr (alloc_traits::propagate_on_container_swap::value) {
+					swap(m_alloc, other.m_alloc);
+				}
+				swap(m_data, other.m_data);
+				swap(m_size, other.m_size);
+				swap(m_capacity, other.m_capacity);
+			}
+			else {
+				small_vector tmp(std::move(other));
+				other = std::move(*this);
+				*this = std::move(tmp);
+			}
+		}
+
+		friend bool operator==(const small_vector& lhs, const small_vector& rhs) {
+			return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+		}
+		friend bool operator!=(const small_vector& lhs, const small_vector& rhs) {
+			return !(lhs == rhs);
+		}
+		friend bool operator<(const small_vector& lhs, const small_vector& rhs) {
+			return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+		}
+	private:
+		Ty* inline_data() noexcept {
+			return std::launder(reinterpret_cast<Ty*>(m_buffer));
+		}
+		const Ty* inline_data() const noexcept {
+			return std::launder(reinterpret_cast<const Ty*>(m_buffer));
+		}
+
+		void verify_idx(size_t idx) const {
+			if (idx >= m_size) {
+				throw std::out_of_range("small_vector index out of range");
+			}
+		}
+
+		template <class InputIt>
+		void append(InputIt first, InputIt last) {
+			if constexpr (is_forward_v<InputIt>) {
+				reserve(m_size + static_cast<size_t>(std::distance(first, last)));
+			}
+			for (; first != last; ++first) {
+				emplace_back(*first);
+			}
+		}
+
+		template <class... Types>
+		void resize_impl(size_t count, const Types&... value) {						//Value-initialized without the value
+			if (count <= m_size) {
+				destroy_tail(count);
+				return;
+			}
+			reserve(count);
+			while (m_size < count) {
+				alloc_traits::construct(m_alloc, m_data + m_size, value...);
+				++m_size;
+			}
+		}
+
+		template <class... Types>
+		Ty& grow_emplace_back(Types&&... args) {									//args may refer to an element: constructed before the others move
+			const size_t new_capacity{ next_capacity(m_size + 1) };
+			Ty* new_data{ alloc_traits::allocate(m_alloc, new_capacity) };
+			try {
+				alloc_traits::construct(m_alloc, new_data + m_size, std::forward<Types>(args)...);
+				try {
+					relocate(new_data, new_capacity);
+				}
+				catch (...) {
+					alloc_traits::destroy(m_alloc, new_data + m_size);
+					throw;
+				}
+			}
+			catch (...) {
+				alloc_traits::deallocate(m_alloc, new_data, new_capacity);
+				throw;
+			}
+			return m_data[m_size++];
+		}
+		void reallocate(size_t new_capacity) {										//new_capacity >= m_size
+			if (new_capacity <= inline_capacity) {
+				if (!is_inline()) {
+					relocate(inline_data(), inline_capacity);
+				}
+				return;
+			}
+			Ty* new_data{ alloc_traits::allocate(m_alloc, new_capacity) };
+			try {
+				relocate(new_data, new_capacity);
+			}
+			catch (...) {
+				alloc_traits::deallocate(m_alloc, new_data, new_capacity);
+				throw;
+			}
+		}
+		void relocate(Ty* new_data, size_t new_capacity) {
+			size_t moved{ 0 };
+			try {
+				for (; moved < m_size; ++moved) {
+					alloc_traits::construct(m_alloc, new_data + moved, std::move_if_noexcept(m_data[moved]));
+				}
+			}
+			catch (...) {
+				std::destroy(new_data, new_data + moved);							//The caller frees new_data
+				throw;
+			}
+			std::destroy(m_data, m_data + m_size);
+			if (!is_inline()) {
+				alloc_traits::deallocate(m_alloc, m_data, m_capacity);
+			}
+			m_data = new_data;
+			m_capacity = new_capacity;
+		}
+		size_t next_capacity(size_t required) const noexcept {
+			return std::max(required, m_capacity * 2);
+		}
+
+		void take(small_vector&& other) {											//*this is empty and inline
+			if (!other.is_inline() && m_alloc == other.m_alloc) {
+				m_data = std::exchange(other.m_data, other.inline_data());
+				m_size = std::exchange(other.m_size, 0);
+				m_capacity = std::exchange(other.m_capacity, inline_capacity);
+				return;
+			}
+			reserve(other.m_size);
+			for (auto& value : other) {
+				alloc_traits::construct(m_alloc, m_data + m_size, std::move(value));
+				++m_size;
+			}
+			other.clear();
+		}
+		void release() noexcept {													//Leaves *this empty and inline
+			clear();
+			if (!is_inline()) {
+				alloc_traits::deallocate(m_alloc, m_data, m_capacity);
+				m_data = inline_data();
+				m_capacity = inline_capacity;
+			}
+		}
+		void destroy_tail(size_t new_size) noexcept {
+			for (size_t idx = new_size; idx < m_size; ++idx) {
+				alloc_traits::destroy(m_alloc, m_data + idx);
+			}
+			m_size = new_size;
+		}
+	private:
+		Allocator m_alloc;
+		Ty* m_data{ inline_data() };
+		size_t m_size{ 0 },
+			m_capacity{ inline_capacity };
+		alignas(Ty) unsigned char m_buffer[(std::max)(inline_capacity, size_t{ 1 }) * sizeof(Ty)];	//No initializer: left uninitialized
+	};
+
+	template <class Ty, size_t inline_capacity, class Allocator>
+	void swap(small_vector<Ty, inline_capacity, Allocator>& lhs, small_vector<Ty, inline_capacity, Allocator>& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+		lhs.swap(rhs);
+	}
+}
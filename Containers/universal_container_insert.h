@@ -1,15 +1,40 @@
 #pragma once
+#include "container_traits.h"
+
+#include <iterator>
 #include <type_traits>
 #include <utility>
 
 namespace utility::container {
+	namespace details {
+		template <class Container, class Iterator, class = void>
+		struct has_range_insert
+			: std::false_type {};
+
+		template <class Container, class Iterator>
+		struct has_range_insert<Container, Iterator, std::void_t<
+			decltype(std::declval<Container&>().insert(std::declval<Container&>().end(), std::declval<Iterator>(), std::declval<Iterator>()))>>
+			: std::true_type {};
+
+		template <class Iterator>
+		inline constexpr bool is_forward_iterator_v{																	//Can be traversed twice: to count and to insert
+			std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category> };
+
+		template <class Container, class Iterator>
+		void reserve_for(Container& cont, Iterator first, Iterator last) {
+			if constexpr (has_reserve_v<Container> && is_forward_iterator_v<Iterator>) {
+				cont.reserve(cont.size() + static_cast<size_t>(std::distance(first, last)));
+			}
+		}
+	}
+
 	template <class Container, class Ty>
 	decltype(auto) insert(Container& cont, Ty&& value) {
 		if constexpr (is_linear_v<Container>) {
 			cont.push_back(std::forward<Ty>(value));
 			return cont.back();
 		}
-		else if (is_associative_v<Container>) {
+		else if constexpr (is_associative_v<Container>) {
 			return cont.insert(std::forward<Ty>(value));
 		}
 	}
@@ -18,4 +43,52 @@ namespace utility::container {
 	decltype(auto) insert(Container& cont, Iterator where, Ty&& value) {
 		return cont.insert(where, std::forward<Ty>(value));
 	}
-}
\ No newline at end of file
+
+	template <class Container, class Iterator>
+	void insert_range(Container& cont, Iterator first, Iterator last) {							//Pass std::move_iterator to move the elements
+		if constexpr (is_linear_v<Container>) {
+			if constexpr (details::has_range_insert<Container, Iterator>::value) {
+				cont.insert(cont.end(), first, last);											//Reserves by itself if the size is known
+			}
+			else {
+				details::reserve_for(cont, first, last);
+				for (; first != last; ++first) {
+					cont.push_back(*first);
+				}
+			}
+		}
+		else if constexpr (is_set_v<Container> || is_map_v<Container>) {
+			if constexpr (is_ordered_v<Container> && has_reserve_v<Container>) {
+				cont.insert(first, last);														//A sorted array (flat_set, flat_map): merged in bulk
+			}																					//instead of shifting the tail for every element
+			else if constexpr (is_ordered_v<Container>) {
+				auto hint{ cont.end() };														//Ascending runs are inserted in amortized O(1):
+				for (; first != last; ++first) {												//each element goes right after the previous one
+					hint = std::next(cont.emplace_hint(hint, *first));
+				}
+			}
+			else {
+				details::reserve_for(cont, first, last);										//No rehashing on the way
+				for (; first != last; ++first) {
+					cont.emplace(*first);
+				}
+			}
+		}
+		else {
+			static_assert(is_associative_v<Container>, "Container doesn't support insertion");
+			for (; first != last; ++first) {
+				cont.insert(*first);
+			}
+		}
+	}
+
+	template <class Container, class Range>
+	void insert_range(Container& cont, Range&& range) {											//Elements of an rvalue range are moved, an lvalue one is left intact
+		if constexpr (std::is_lvalue_reference_v<Range>) {
+			insert_range(cont, std::begin(range), std::end(range));
+		}
+		else {
+			insert_range(cont, std::make_move_iterator(std::begin(range)), std::make_move_iterator(std::end(range)));
+		}
+	}
+}
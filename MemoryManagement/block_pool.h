@@ -0,0 +1,161 @@
+#pragma once
+#include "pool_allocator.h"
+
+#include <new>
+#include <tuple>
+#include <mutex>
+#include <memory>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+namespace utility::memory {
+	namespace details {
+		template <size_t size>
+		struct Block {
+			byte data[size];
+		};
+
+		template <size_t size>
+		class BlockSizeClass {														//Freed blocks are kept here instead of being returned to PoolAllocator:
+		public:																	//the top page of the latter would be released and allocated again
+			void* allocate() {
+				std::lock_guard lock(m_mtx);
+				if (m_ftop) {
+					void* block{ m_ftop };
+					m_ftop = m_ftop->prev;
+					return block;
+				}
+				return m_pages.allocate(1);
+			}
+			void deallocate(void* block) noexcept {
+				std::lock_guard lock(m_mtx);
+				m_ftop = new (block) FreeBlock(m_ftop);
+			}
+		private:
+			std::mutex m_mtx;
+			PoolAllocator<Block<size>> m_pages;
+			FreeBlock* m_ftop{ nullptr };
+		};
+	}
+
+	class BlockPool {															//Thread-safe pool of blocks of several size classes for short-lived objects of various types (e.g. asio handlers)
+	public:
+		static constexpr size_t MIN_BLOCK_SIZE{ 64 },
+								SIZE_CLASS_COUNT{ 7 },							//Powers of two
+								MAX_BLOCK_SIZE{ MIN_BLOCK_SIZE << (SIZE_CLASS_COUNT - 1) },	//Larger blocks come from operator new
+								MAX_ALIGNMENT{ alignof(Page) };					//Blocks inherit the alignment of PoolAllocator pages
+	private:
+		template <size_t... idx>
+		static auto make_size_classes(std::index_sequence<idx...>)
+			-> std::tuple<details::BlockSizeClass<(MIN_BLOCK_SIZE << idx)>...>;
+
+		using size_classes_t = decltype(make_size_classes(std::make_index_sequence<SIZE_CLASS_COUNT>{}));
+	public:
+		BlockPool() = default;
+		BlockPool(const BlockPool&) = delete;
+		BlockPool& operator=(const BlockPool&) = delete;
+	public:
+		void* allocate(size_t bytes, size_t alignment = MAX_ALIGNMENT) {
+			if (!pooled(bytes, alignment)) {
+				return operator new(bytes, std::align_val_t{ alignment });
+			}
+			return allocate_pooled(size_class_of(bytes), std::make_index_sequence<SIZE_CLASS_COUNT>{});
+		}
+		void deallocate(void* ptr, size_t bytes, size_t alignment = MAX_ALIGNMENT) noexcept {	//bytes and alignment must match allocate()
+			if (!pooled(bytes, alignment)) {
+				operator delete(ptr, bytes, std::align_val_t{ alignment });
+			}
+			else {
+				deallocate_pooled(ptr, size_class_of(bytes), std::make_index_sequence<SIZE_CLASS_COUNT>{});
+			}
+		}
+	private:
+		static constexpr bool pooled(size_t bytes, size_t alignment) noexcept {
+			return bytes <= MAX_BLOCK_SIZE && alignment <= MAX_ALIGNMENT;
+		}
+		static constexpr size_t size_class_of(size_t bytes) noexcept {
+			size_t class_idx{ 0 };
+			for (size_t size = MIN_BLOCK_SIZE; size < bytes; size <<= 1) {
+				++class_idx;
+			}
+			return class_idx;
+		}
+
+		template <size_t... idx>
+		void* allocate_pooled(size_t class_idx, std::index_sequence<idx...>) {
+			void* block{ nullptr };
+			((idx == class_idx && (block = std::get<idx>(m_size_classes).allocate(), true)) || ...);
+			return block;
+		}
+		template <size_t... idx>
+		void deallocate_pooled(void* block, size_t class_idx, std::index_sequence<idx...>) noexcept {
+			((idx == class_idx && (std::get<idx>(m_size_classes).deallocate(block), true)) || ...);
+		}
+	private:
+		size_classes_t m_size_classes;
+	};
+
+	template <class Ty>
+	class BlockPoolAllocator {													//Copies share the pool and keep it alive
+	public:
+		using value_type = Ty;
+
+		using is_always_equal = std::false_type;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		template <class OtherTy>
+		struct rebind {
+			using other = BlockPoolAllocator<OtherTy>;
+		};
+	public:
+		BlockPoolAllocator() noexcept = default;								//Without a pool memory comes from operator new
+		explicit BlockPoolAllocator(std::shared_ptr<BlockPool> pool) noexcept
+			: m_pool{ std::move(pool) }
+		{
+		}
+		template <class OtherTy>
+		BlockPoolAllocator(const BlockPoolAllocator<OtherTy>& other) noexcept
+			: m_pool{ other.m_pool }
+		{
+		}
+
+		template <class OtherTy>
+		bool operator==(const BlockPoolAllocator<OtherTy>& other) const noexcept {
+			return m_pool == other.m_pool;
+		}
+		template <class OtherTy>
+		bool operator!=(const BlockPoolAllocator<OtherTy>& other) const noexcept {
+			return !(*this == other);
+		}
+	public:
+		Ty* allocate(size_t count) {
+			if (count > std::allocator_traits<std::allocator<Ty>>::max_size(std::allocator<Ty>{})) {
+				throw std::bad_array_new_length();
+			}
+			if (!m_pool) {
+				return std::allocator<Ty>{}.allocate(count);
+			}
+			return static_cast<Ty*>(m_pool->allocate(count * sizeof(Ty), alignof(Ty)));
+		}
+		void deallocate(Ty* ptr, size_t count) noexcept {
+			if (!m_pool) {
+				std::allocator<Ty>{}.deallocate(ptr, count);
+			}
+			else {
+				m_pool->deallocate(ptr, count * sizeof(Ty), alignof(Ty));
+			}
+		}
+
+		const std::shared_ptr<BlockPool>& pool() const noexcept {
+			return m_pool;
+		}
+	private:
+		template <class OtherTy>
+		friend class BlockPoolAllocator;
+	private:
+		std::shared_ptr<BlockPool> m_pool;
+	};
+}
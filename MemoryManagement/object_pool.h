@@ -0,0 +1,295 @@
+#pragma once
+#include "pool_allocator.h"
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+
+namespace utility::memory {
+	struct ObjectPoolSettings {
+		size_t thread_cache_size{ 16 },											//Idle objects kept by each thread cache; 0 disables the caches
+			max_idle{ 1024 };													//Idle objects kept by the shared list; the surplus is destroyed
+	};
+
+	/*********************************************************************
+	Recycles constructed objects instead of their memory: acquire() hands
+	out an RAII handle to an idle object (or constructs a new one from its
+	arguments if there is none), and the handle gives the object back
+	after running the reset hook on it. Returned objects land in a small
+	cache picked by the calling thread, so the acquire/release loop of a
+	thread takes no lock; the caches exchange objects with a shared list
+	in batches. Memory comes from Allocator (PoolAllocator by default),
+	which is only touched under the lock of the shared list.
+	The pool must outlive its handles
+	*********************************************************************/
+	template <class Ty, class Allocator = PoolAllocator<Ty>>
+	class ObjectPool {
+	public:
+		using value_type = Ty;
+		using allocator_type = Allocator;
+		using reset_hook = std::function<void(Ty&)>;							//Restores a returned object to a reusable state; throwing drops the object
+
+		class Handle {
+		public:
+			Handle() noexcept = default;
+			Handle(const Handle&) = delete;
+			Handle& operator=(const Handle&) = delete;
+			Handle(Handle&& other) noexcept
+				: m_pool{ std::exchange(other.m_pool, nullptr) }, m_object{ std::exchange(other.m_object, nullptr) }
+			{
+			}
+			Handle& operator=(Handle&& other) noexcept {
+				if (this != std::addressof(other)) {
+					reset();
+					m_pool = std::exchange(other.m_pool, nullptr);
+					m_object = std::exchange(other.m_object, nullptr);
+				}
+				return *this;
+			}
+			~Handle() noexcept { reset(); }
+		public:
+			Ty* get() const noexcept { return m_object; }
+			Ty& operator*() const noexcept { return *m_object; }
+			Ty* operator->() const noexcept { return m_object; }
+			explicit operator bool() const noexcept { return m_object != nullptr; }
+
+			void reset() noexcept {												//Returns the object to the pool ahead of time
+				if (m_object) {
+					std::exchange(m_pool, nullptr)->recycle(std::exchange(m_object, nullptr));
+				}
+			}
+		private:
+			friend class ObjectPool;
+
+			Handle(ObjectPool* pool, Ty* object) noexcept
+				: m_pool{ pool }, m_object{ object }
+			{
+			}
+		private:
+			ObjectPool* m_pool{ nullptr };
+			Ty* m_object{ nullptr };
+		};
+	private:
+		using alloc_traits = std::allocator_traits<Allocator>;
+
+		static constexpr size_t CACHE_LINE_SIZE{ 64 };
+
+		struct alignas(CACHE_LINE_SIZE) ThreadCache {							//Shared by the threads with the same index modulo the cache count
+			std::atomic_flag busy = ATOMIC_FLAG_INIT;							//acquire() and returns bypass a busy cache instead of waiting
+			std::vector<Ty*> objects;
+		};
+	public:
+		explicit ObjectPool(reset_hook reset = {}, ObjectPoolSettings settings = {}, Allocator alloc = Allocator{})
+			: m_reset{ std::move(reset) }, m_settings{ settings }, m_alloc(std::move(alloc))
+		{
+			if (m_settings.thread_cache_size) {
+				m_cache_count = round_up_to_power_of_two((std::max)(std::thread::hardware_concurrency(), 1u));
+				m_caches = std::make_unique<ThreadCache[]>(m_cache_count);
+				for (size_t idx = 0; idx < m_cache_count; ++idx) {
+					m_caches[idx].objects.reserve(m_settings.thread_cache_size);	//Never reallocated afterwards
+				}
+			}
+			m_idle.reserve(m_settings.max_idle);								//Returning an object never allocates
+		}
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+		~ObjectPool() noexcept {
+			clear();
+		}
+	public:
+		template <class... Types>
+		Handle acquire(Types&&... args) {										//The arguments are used only if a new object has to be constructed
+			if (Ty* object = pop()) {
+				return Handle{ this, object };
+			}
+			return Handle{ this, create(std::forward<Types>(args)...) };
+		}
+
+		void reserve(size_t count) {											//Constructs default objects until count of them are idle (at most max_idle)
+			count = (std::min)(count, m_settings.max_idle);
+			std::vector<Ty*> created;
+			created.reserve(count);
+			try {
+				while (idle_count() + created.size() < count) {
+					created.push_back(create());
+				}
+			}
+			catch (...) {
+				destroy(created.begin(), created.end());
+				throw;
+			}
+			std::lock_guard lock(m_mtx);
+			const size_t accepted{ (std::min)(created.size(), m_settings.max_idle - m_idle.size()) };	//Others may have been returned meanwhile
+			m_idle.insert(m_idle.end(), created.begin(), created.begin() + static_cast<std::ptrdiff_t>(accepted));
+			destroy_locked(created.begin() + static_cast<std::ptrdiff_t>(accepted), created.end());
+		}
+		void clear() noexcept {													//Destroys the idle objects; handed out ones are unaffected
+			for (size_t idx = 0; idx < m_cache_count; ++idx) {
+				ThreadCache& cache{ wait_cache(m_caches[idx]) };
+				destroy(cache.objects.begin(), cache.objects.end());
+				cache.objects.clear();
+				cache.busy.clear(std::memory_order_release);
+			}
+			std::lock_guard lock(m_mtx);
+			destroy_locked(m_idle.begin(), m_idle.end());
+			m_idle.clear();
+		}
+
+		size_t idle_count() const noexcept {									//Approximate while the pool is in use
+			size_t count{ 0 };
+			for (size_t idx = 0; idx < m_cache_count; ++idx) {
+				ThreadCache& cache{ wait_cache(m_caches[idx]) };
+				count += cache.objects.size();
+				cache.busy.clear(std::memory_order_release);
+			}
+			std::lock_guard lock(m_mtx);
+			return count + m_idle.size();
+		}
+	private:
+		Ty* pop() noexcept {
+			if (ThreadCache* cache = lock_cache()) {
+				if (cache->objects.empty()) {
+					std::lock_guard lock(m_mtx);								//A batch instead of taking the lock for every object
+					const size_t batch{ (std::min)(m_idle.size(), (m_settings.thread_cache_size + 1) / 2) };
+					cache->objects.insert(cache->objects.end(), m_idle.end() - static_cast<std::ptrdiff_t>(batch), m_idle.end());
+					m_idle.resize(m_idle.size() - batch);
+				}
+				Ty* object{ nullptr };
+				if (!cache->objects.empty()) {
+					object = cache->objects.back();
+					cache->objects.pop_back();
+				}
+				cache->busy.clear(std::memory_order_release);
+				return object;
+			}
+			std::lock_guard lock(m_mtx);
+			if (m_idle.empty()) {
+				return nullptr;
+			}
+			Ty* object{ m_idle.back() };
+			m_idle.pop_back();
+			return object;
+		}
+
+		void recycle(Ty* object) noexcept {
+			if (m_reset) {
+				try {
+					m_reset(*object);
+				}
+				catch (...) {
+					destroy(&object, &object + 1);
+					return;
+				}
+			}
+			if (ThreadCache* cache = lock_cache()) {
+				if (cache->objects.size() == m_settings.thread_cache_size) {
+					flush(*cache);
+				}
+				cache->objects.push_back(object);
+				cache->busy.clear(std::memory_order_release);
+				return;
+			}
+			std::lock_guard lock(m_mtx);
+			if (m_idle.size() < m_settings.max_idle) {
+				m_idle.push_back(object);
+			}
+			else {
+				destroy_locked(&object, &object + 1);
+			}
+		}
+
+		void flush(ThreadCache& cache) noexcept {								//Moves the older half of a full cache to the shared list
+			auto& objects{ cache.objects };
+			const auto middle{ objects.begin() + static_cast<std::ptrdiff_t>((objects.size() + 1) / 2) };
+			auto surplus{ objects.begin() };
+			{
+				std::lock_guard lock(m_mtx);
+				const size_t accepted{ (std::min)(static_cast<size_t>(middle - objects.begin()), m_settings.max_idle - m_idle.size()) };
+				surplus += static_cast<std::ptrdiff_t>(accepted);
+				m_idle.insert(m_idle.end(), objects.begin(), surplus);
+			}
+			destroy(surplus, middle);
+			objects.erase(objects.begin(), middle);
+		}
+
+		static ThreadCache& wait_cache(ThreadCache& cache) noexcept {
+			while (cache.busy.test_and_set(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			return cache;
+		}
+		ThreadCache* lock_cache() noexcept {
+			if (!m_cache_count) {
+				return nullptr;
+			}
+			ThreadCache& cache{ m_caches[thread_index() & (m_cache_count - 1)] };
+			return cache.busy.test_and_set(std::memory_order_acquire) ? nullptr : &cache;
+		}
+
+		template <class... Types>
+		Ty* create(Types&&... args) {
+			Ty* object;
+			{
+				std::lock_guard lock(m_mtx);
+				object = alloc_traits::allocate(m_alloc, 1);
+			}
+			try {
+				::new (static_cast<void*>(object)) Ty(std::forward<Types>(args)...);	//Outside the lock: constructors may be expensive
+			}
+			catch (...) {
+				std::lock_guard lock(m_mtx);
+				alloc_traits::deallocate(m_alloc, object, 1);
+				throw;
+			}
+			return object;
+		}
+
+		template <class It>
+		void destroy(It first, It last) noexcept {								//Destructors run outside the lock
+			if (first != last) {
+				for (auto it = first; it != last; ++it) {
+					(*it)->~Ty();
+				}
+				std::lock_guard lock(m_mtx);
+				for (; first != last; ++first) {
+					alloc_traits::deallocate(m_alloc, *first, 1);
+				}
+			}
+		}
+		template <class It>
+		void destroy_locked(It first, It last) noexcept {
+			for (; first != last; ++first) {
+				(*first)->~Ty();
+				alloc_traits::deallocate(m_alloc, *first, 1);
+			}
+		}
+
+		static size_t thread_index() noexcept {
+			static std::atomic<size_t> next_index{ 0 };
+			thread_local const size_t index{ next_index.fetch_add(1, std::memory_order_relaxed) };
+			return index;
+		}
+		static size_t round_up_to_power_of_two(size_t value) noexcept {
+			size_t power{ 1 };
+			while (power < value) {
+				power <<= 1;
+			}
+			return power;
+		}
+	private:
+		const reset_hook m_reset;
+		const ObjectPoolSettings m_settings;
+		size_t m_cache_count{ 0 };
+		std::unique_ptr<ThreadCache[]> m_caches;
+		mutable std::mutex m_mtx;
+		std::vector<Ty*> m_idle;
+		Allocator m_alloc;
+	};
+}
@@ -10,6 +10,7 @@ Dmitry Bolshakov, September 2020
 
 #include <tuple>
 #include <memory>
+#include <utility>
 #include <cassert>
 #include <algorithm>
 #include <type_traits>
@@ -19,6 +19,8 @@ namespace utility::memory {
 			using other = StaticPoolAllocator<OtherTy, capacity>;
 		};
 	private:
+		using MyBase::BLOCK_SIZE;												//  :    
+
 		struct MemoryManagement {
 			alignas(Ty) byte storage[capacity * BLOCK_SIZE] = {};
 			FreeBlock* ftop{ nullptr };
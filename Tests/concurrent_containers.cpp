@@ -0,0 +1,221 @@
+#include "test.h"
+#include "../Containers/mpmc_queue.h"
+#include "../Containers/concurrent_hash_map.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+mpmc_queue: FIFO order, the full and empty states, the elements counted
+through a multi-threaded run, and a cell published after a throwing
+constructor or move-assignment. concurrent_hash_map: insert, find,
+visit and erase, alone and from several threads at once
+*********************************************************************/
+namespace {
+	constexpr size_t THREAD_COUNT{ 4 },
+		OPERATIONS_PER_THREAD{ 20000 };
+
+	/*********************************************************************
+	Throws from the converting constructor taken by a string and, when
+	asked, from the move-assignment; the move constructor is nothrow as
+	mpmc_queue requires
+	*********************************************************************/
+	struct fragile {
+		static inline bool throw_on_assign{ false };
+
+		explicit fragile(int number) noexcept : value{ number } {}
+		explicit fragile(const string& text) : value{ stoi(text) } {}		//std::invalid_argument for non-numbers
+		fragile(fragile&&) noexcept = default;
+		fragile& operator=(fragile&& other) {
+			if (throw_on_assign) {
+				throw runtime_error("move-assignment");
+			}
+			value = other.value;
+			return *this;
+		}
+
+		int value;
+	};
+
+	void test_fifo_full_empty() {
+		container::mpmc_queue<int> queue{ 5 };
+		CHECK(queue.capacity() == 8);
+		CHECK(queue.empty());
+		int value{ -1 };
+		CHECK(!queue.try_pop(value));
+		CHECK(value == -1);
+
+		for (int idx = 0; idx < 8; ++idx) {
+			CHECK(queue.try_push(idx));
+		}
+		CHECK(queue.full());
+		CHECK(!queue.try_push(8));
+		for (int round = 0; round < 3; ++round) {								//Wraps around the ring
+			for (int idx = 0; idx < 8; ++idx) {
+				CHECK(queue.try_pop(value));
+				CHECK(value == round * 8 + idx);
+				CHECK(queue.try_push((round + 1) * 8 + idx));
+			}
+		}
+		for (int idx = 0; idx < 8; ++idx) {
+			CHECK(queue.try_pop(value));
+			CHECK(value == 24 + idx);
+		}
+		CHECK(queue.empty());
+		CHECK(!queue.try_pop(value));
+	}
+
+	void test_throwing_element() {
+		container::mpmc_queue<fragile> queue{ 2 };
+		bool thrown{ false };
+		try {
+			queue.try_emplace(string{ "not a number" });
+		}
+		catch (const invalid_argument&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		CHECK(queue.empty());													//Nothing was claimed
+		CHECK(queue.try_emplace(string{ "1" }));
+		CHECK(queue.try_emplace(2));
+
+		fragile popped{ 0 };
+		fragile::throw_on_assign = true;
+		thrown = false;
+		try {
+			queue.try_pop(popped);
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		fragile::throw_on_assign = false;
+		CHECK(thrown);
+		CHECK(queue.size_approx() == 1);										//The first element is lost, its cell is free
+		CHECK(queue.try_emplace(3));
+		CHECK(queue.try_pop(popped));
+		CHECK(popped.value == 2);
+		CHECK(queue.try_pop(popped));
+		CHECK(popped.value == 3);
+		CHECK(!queue.try_pop(popped));
+	}
+
+	void test_concurrent_queue() {
+		container::mpmc_queue<uint64_t> queue{ 64 };
+		atomic<uint64_t> popped_count{ 0 }, popped_sum{ 0 };
+		vector<thread> threads;
+		for (size_t thread_idx = 0; thread_idx < THREAD_COUNT; ++thread_idx) {
+			threads.emplace_back([&queue, thread_idx] {							//Producers
+				for (uint64_t idx = 0; idx < OPERATIONS_PER_THREAD; ++idx) {
+					while (!queue.try_push(thread_idx * OPERATIONS_PER_THREAD + idx)) {
+						this_thread::yield();
+					}
+				}
+			});
+			threads.emplace_back([&queue, &popped_count, &popped_sum] {			//Consumers
+				uint64_t value, count{ 0 }, sum{ 0 };
+				while (count < OPERATIONS_PER_THREAD) {
+					if (queue.try_pop(value)) {
+						++count;
+						sum += value;
+					}
+					else {
+						this_thread::yield();
+					}
+				}
+				popped_count += count;
+				popped_sum += sum;
+			});
+		}
+		for (auto& worker : threads) {
+			worker.join();
+		}
+		const uint64_t total{ THREAD_COUNT * OPERATIONS_PER_THREAD };
+		CHECK(popped_count == total);
+		CHECK(popped_sum == total * (total - 1) / 2);							//Every value exactly once
+		CHECK(queue.empty());
+	}
+
+	void test_hash_map() {
+		container::concurrent_hash_map<int, string> map{ 4 };
+		CHECK(map.shard_count() == 4);
+		CHECK(map.insert({ 1, "one" }));
+		CHECK(map.emplace(2, "two"));
+		CHECK(map.try_emplace(3, "three"));
+		CHECK(!map.insert({ 1, "uno" }));
+		CHECK(!map.try_emplace(2, "dos"));
+		CHECK(!map.insert_or_assign(3, string{ "tres" }));
+		CHECK(map.size() == 3);
+
+		CHECK(map.find(1) == "one");
+		CHECK(map.find(3) == "tres");
+		CHECK(!map.find(4));
+		CHECK(map.contains(2));
+
+		CHECK(map.visit(2, [](string& value) { value += "!"; }));
+		CHECK(!map.visit(4, [](string&) {}));
+		CHECK(map.find(2) == "two!");
+		size_t length{ 0 };
+		as_const(map).visit_all([&length](const auto& value) { length += value.second.size(); });
+		CHECK(length == 3 + 4 + 4);
+
+		CHECK(map.erase(1));
+		CHECK(!map.erase(1));
+		CHECK(!map.contains(1));
+		map.clear();
+		CHECK(map.empty());
+	}
+
+	void test_concurrent_hash_map() {
+		constexpr uint64_t SHARED_KEYS{ 16 };
+		container::concurrent_hash_map<uint64_t, uint64_t> map;
+		for (uint64_t key = 0; key < SHARED_KEYS; ++key) {
+			map.try_emplace(key, 0);
+		}
+		atomic<uint64_t> erased{ 0 };
+		vector<thread> threads;
+		for (size_t thread_idx = 0; thread_idx < THREAD_COUNT; ++thread_idx) {
+			threads.emplace_back([&map, &erased, thread_idx] {
+				const uint64_t first{ SHARED_KEYS + thread_idx * OPERATIONS_PER_THREAD };
+				for (uint64_t key = first; key < first + OPERATIONS_PER_THREAD; ++key) {
+					map.try_emplace(key, key);
+					map.visit(key % SHARED_KEYS, [](uint64_t& value) { ++value; });	//Under the exclusive lock
+				}
+				for (uint64_t key = first; key < first + OPERATIONS_PER_THREAD; key += 2) {
+					erased += map.erase(key);
+				}
+			});
+		}
+		for (auto& worker : threads) {
+			worker.join();
+		}
+		const uint64_t total{ THREAD_COUNT * OPERATIONS_PER_THREAD };
+		CHECK(erased == total / 2);
+		CHECK(map.size() == SHARED_KEYS + total / 2);
+		uint64_t visits{ 0 };
+		map.visit_all([&visits](const auto& value) {
+			if (value.first < SHARED_KEYS) {
+				visits += value.second;
+			}
+		});
+		CHECK(visits == total);													//No increment lost
+		CHECK(map.find(SHARED_KEYS + 1) == SHARED_KEYS + 1);
+		CHECK(!map.find(SHARED_KEYS));
+	}
+}
+
+int main() {
+	test_fifo_full_empty();
+	test_throwing_element();
+	test_concurrent_queue();
+	test_hash_map();
+	test_concurrent_hash_map();
+	return test::result();
+}
@@ -0,0 +1,112 @@
+#include "test.h"
+#include "../Web/coroutine.hpp"
+#include "../Web/http_coroutine.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <stdexcept>
+
+using namespace std;
+using namespace utility;
+using namespace utility::concurrency;
+
+/*********************************************************************
+The coroutine layer needs C++20, while the rest of the tree builds as
+C++17: this test is its only translation unit, so it instantiates
+every awaitable (Task, ThreadPool::ScheduleAwaiter, ControllerAwaiter,
+the asio ones and web::http::SessionAwaiter) and runs them once
+*********************************************************************/
+namespace {
+	coro::Task<int> answer() {
+		co_return 21;
+	}
+
+	coro::Task<int> twice() {
+		const int first{ co_await answer() };
+		co_return first + co_await answer();
+	}
+
+	coro::Task<void> fail() {
+		throw runtime_error{ "expected" };
+		co_return;
+	}
+
+	coro::Task<thread::id> hop(ThreadPool& pool) {
+		co_await pool.Schedule();
+		co_return std::this_thread::get_id();
+	}
+
+	coro::Task<void> wait_for(ThreadController& controller, atomic<bool>& resumed) {
+		co_await controller;
+		resumed = true;
+	}
+
+	coro::Task<boost::system::error_code> sleep_on(boost::asio::io_context& io) {
+		co_await coro::Schedule(io);
+		boost::asio::steady_timer timer{ io, chrono::milliseconds{ 1 } };
+		auto [error]{ co_await coro::FromCallback<boost::system::error_code>([&timer](auto handler) {
+			timer.async_wait(move(handler));
+		}) };
+		co_return error;
+	}
+
+	coro::Task<web::http::session_holder> fetch(web::http::Client& client, web::http::request req) {
+		co_return co_await client.SendRequest(move(req));
+	}
+
+	void test_tasks() {
+		CHECK(coro::SyncWait(twice()) == 42);
+		bool thrown{ false };
+		try {
+			coro::SyncWait(fail());
+		}
+		catch (const runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	void test_thread_pool() {
+		ThreadPool pool{ 2 };
+		CHECK(coro::SyncWait(hop(pool)) != std::this_thread::get_id());
+		CHECK(coro::SyncWait(coro::Async(pool, [](int lhs, int rhs) { return lhs * rhs; }, 6, 7)) == 42);
+
+		ThreadController controller;
+		atomic<bool> resumed{ false };
+		coro::Spawn(wait_for(controller, resumed));
+		CHECK(!resumed);
+		controller.Stop();
+		controller.NotifyAll();
+		CHECK(resumed);
+	}
+
+	void test_asio() {
+		boost::asio::io_context io;
+		auto work{ boost::asio::make_work_guard(io) };
+		thread runner{ [&io] { io.run(); } };
+		CHECK(!coro::SyncWait(sleep_on(io)));
+		work.reset();
+		runner.join();
+	}
+
+	void test_http() {															//Nothing listens on port 1: the session fails at once
+		web::http::Client client;
+		web::http::request req{ web::http::method::get, "/", 11 };
+		req.set(web::http::field::host, "127.0.0.1");
+		req.set(web::http::field::protocol, "1");
+		const auto session{ coro::SyncWait(fetch(client, move(req))) };
+		CHECK(session && session->GetSessionStatus() == web::http::Session::Status::Fail);
+	}
+}
+
+int main() {
+	test_tasks();
+	test_thread_pool();
+	test_asio();
+	test_http();
+	return test::result();
+}
@@ -0,0 +1,75 @@
+#include "test.h"
+#include "../Containers/flat_hash_map.h"
+#include "../MemoryManagement/block_pool.h"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+flat_hash_map over memory::BlockPoolAllocator: the slot and control
+arrays are allocated through rebound copies of the allocator, so a
+table growing, shrinking, copied and moved must return every block to
+the pool it came from and stay consistent with std::unordered_map
+*********************************************************************/
+namespace {
+	using allocator_type = memory::BlockPoolAllocator<pair<const uint64_t, string>>;
+	using map_type = container::flat_hash_map<uint64_t, string, hash<uint64_t>, equal_to<uint64_t>, allocator_type>;
+
+	constexpr uint64_t KEY_COUNT{ 5000 };
+
+	bool same_contents(const map_type& map, const unordered_map<uint64_t, string>& expected) {
+		if (map.size() != expected.size()) {
+			return false;
+		}
+		for (const auto& [key, value] : expected) {
+			const auto where{ map.find(key) };
+			if (where == map.end() || where->second != value) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void test_block_pool_allocator() {
+		const auto pool{ make_shared<memory::BlockPool>() };
+		unordered_map<uint64_t, string> expected;
+		map_type map{ allocator_type{ pool } };
+		CHECK(map.get_allocator() == allocator_type{ pool });
+
+		for (uint64_t key = 0; key < KEY_COUNT; ++key) {						//Rehashes through every pooled size class and beyond
+			map.try_emplace(key * 7919, to_string(key));
+			expected.try_emplace(key * 7919, to_string(key));
+		}
+		CHECK(same_contents(map, expected));
+		for (uint64_t key = 0; key < KEY_COUNT; key += 2) {
+			map.erase(key * 7919);
+			expected.erase(key * 7919);
+		}
+		CHECK(same_contents(map, expected));
+
+		const map_type copy{ map };
+		CHECK(copy.get_allocator() == map.get_allocator());
+		CHECK(same_contents(copy, expected));
+		map_type moved{ move(map) };
+		CHECK(same_contents(moved, expected));
+
+		moved.clear();
+		moved.rehash(0);
+		for (uint64_t key = 0; key < 10; ++key) {
+			moved[key] = to_string(key);
+		}
+		CHECK(moved.size() == 10 && moved.at(9) == "9");
+	}
+}
+
+int main() {
+	test_block_pool_allocator();
+	return test::result();
+}
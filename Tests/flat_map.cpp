@@ -0,0 +1,75 @@
+#include "test.h"
+#include "../Containers/flat_map.h"
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <iterator>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+flat_map range construction and insertion: an lvalue source is copied
+and left intact, a moved one (std::move_iterator) is moved from; the
+first value of a duplicate key wins
+*********************************************************************/
+namespace {
+	using source_type = vector<pair<string, string>>;
+	using map_type = container::flat_map<string, string>;
+
+	const string LONG_VALUE(64, 'v');											//Beyond the small string buffer: a move empties it
+
+	source_type make_source() {
+		return { { "delta", LONG_VALUE }, { "alpha", LONG_VALUE + "a" }, { "charlie", LONG_VALUE + "c" }, { "alpha", "duplicate" } };
+	}
+
+	void check_contents(const map_type& map) {
+		CHECK(map.size() == 3);
+		CHECK(map.at("alpha") == LONG_VALUE + "a");
+		CHECK(map.at("charlie") == LONG_VALUE + "c");
+		CHECK(map.at("delta") == LONG_VALUE);
+	}
+
+	void test_lvalue_source() {
+		const source_type expected{ make_source() };
+		source_type source{ expected };
+		const map_type constructed(source.begin(), source.end());
+		check_contents(constructed);
+		CHECK(source == expected);
+
+		map_type inserted;
+		inserted.insert(source.begin(), source.end());
+		check_contents(inserted);
+		CHECK(source == expected);
+	}
+
+	void test_rvalue_source() {
+		source_type source{ make_source() };
+		const map_type constructed(make_move_iterator(source.begin()), make_move_iterator(source.end()));
+		check_contents(constructed);
+		CHECK(source[0].first.empty() && source[0].second.empty());
+
+		source = make_source();
+		map_type inserted;
+		inserted.insert(make_move_iterator(source.begin()), make_move_iterator(source.end()));
+		check_contents(inserted);
+		CHECK(source[0].first.empty() && source[0].second.empty());
+	}
+
+	void test_map_source() {													//Proxy references: always copied
+		const source_type values{ make_source() };
+		const map_type source(values.begin(), values.end());
+		map_type copy(source.begin(), source.end());
+		CHECK(copy == source);
+		copy.insert(make_move_iterator(source.begin()), make_move_iterator(source.end()));
+		CHECK(copy == source);
+	}
+}
+
+int main() {
+	test_lvalue_source();
+	test_rvalue_source();
+	test_map_source();
+	return test::result();
+}
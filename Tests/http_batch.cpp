@@ -0,0 +1,162 @@
+#include "test.h"
+#include "../Web/http_client.h"
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+Batches are exempt from the RequestLimiter: a batch completes while a
+single request holds the only slot of the limiter
+*********************************************************************/
+namespace {
+	namespace net = boost::asio;
+	namespace beast = boost::beast;
+	using tcp = net::ip::tcp;
+
+	constexpr size_t BATCH_SIZE{ 8 };
+
+	/*********************************************************************
+	Serves every connection on its own thread and echoes the target; the
+	response to "/hold" waits until release()
+	*********************************************************************/
+	class holding_server {
+	public:
+		holding_server()
+			: m_acceptor{ m_io, { net::ip::make_address("127.0.0.1"), 0 } }
+		{
+			m_thread = thread{ [this] { serve(); } };
+		}
+		~holding_server() {
+			release();
+			m_stop = true;
+			beast::error_code error;
+			tcp::socket wake_up{ m_io };
+			wake_up.connect(m_acceptor.local_endpoint(), error);
+			m_thread.join();
+			{
+				lock_guard lock{ m_mtx };
+				for (auto& socket : m_sockets) {
+					socket.shutdown(tcp::socket::shutdown_both, error);		//Wakes up the readers
+				}
+			}
+			for (auto& connection : m_connections) {
+				connection.join();
+			}
+		}
+	public:
+		unsigned short port() const {
+			return m_acceptor.local_endpoint().port();
+		}
+		void wait_held() {
+			unique_lock lock{ m_mtx };
+			m_cv.wait(lock, [this] { return m_held; });
+		}
+		void release() {
+			{
+				lock_guard lock{ m_mtx };
+				m_released = true;
+			}
+			m_cv.notify_all();
+		}
+	private:
+		void serve() {
+			while (!m_stop) {
+				tcp::socket socket{ m_io };
+				beast::error_code error;
+				m_acceptor.accept(socket, error);
+				if (error || m_stop) {
+					continue;
+				}
+				lock_guard lock{ m_mtx };
+				auto& accepted{ m_sockets.emplace_back(move(socket)) };
+				m_connections.emplace_back([this, &accepted] { answer(accepted); });
+			}
+		}
+
+		void answer(tcp::socket& socket) {
+			beast::flat_buffer buffer;
+			beast::error_code error;
+			while (!error) {
+				beast::http::request<beast::http::string_body> req;
+				beast::http::read(socket, buffer, req, error);
+				if (error) {
+					break;
+				}
+				if (req.target() == "/hold") {
+					unique_lock lock{ m_mtx };
+					m_held = true;
+					m_cv.notify_all();
+					m_cv.wait(lock, [this] { return m_released; });
+				}
+				beast::http::response<beast::http::string_body> res{ beast::http::status::ok, 11 };
+				res.keep_alive(true);
+				res.body() = string{ req.target() };
+				res.prepare_payload();
+				beast::http::write(socket, res, error);
+			}
+		}
+	private:
+		net::io_context m_io;
+		tcp::acceptor m_acceptor;
+		atomic<bool> m_stop{ false };
+		mutex m_mtx;
+		condition_variable m_cv;
+		bool m_held{ false }, m_released{ false };
+		list<tcp::socket> m_sockets;										//Stable addresses for the threads
+		vector<thread> m_connections;
+		thread m_thread;
+	};
+
+	web::http::request make_request(const string& target, unsigned short port) {
+		web::http::request req{ web::http::method::get, target, 11 };
+		req.set(web::http::field::host, "127.0.0.1");
+		req.set(web::http::field::protocol, to_string(port));
+		req.keep_alive(true);
+		return req;
+	}
+
+	void test_batch_bypasses_limiter() {
+		holding_server server;
+		web::http::ClientSettings settings;
+		settings.io_threads = 1;
+		settings.limits.max_in_flight = 1;
+		settings.timeouts.total = chrono::seconds{ 5 };							//A limited batch would fail instead of hanging
+		web::http::Client client{ settings };
+
+		const auto held{ client.SendRequest(make_request("/hold", server.port())) };
+		server.wait_held();														//The only slot is taken
+
+		vector<web::http::request> requests;
+		for (size_t idx = 0; idx < BATCH_SIZE; ++idx) {
+			requests.push_back(make_request("/batch/" + to_string(idx), server.port()));
+		}
+		const auto batch{ client.SendBatch(move(requests), { 2, 4 }) };
+		CHECK(batch.size() == BATCH_SIZE);
+		for (size_t idx = 0; idx < batch.size(); ++idx) {
+			CHECK(!batch[idx]->GetError());
+			CHECK(batch[idx]->GetResponse().body() == "/batch/" + to_string(idx));
+		}
+		CHECK(held->GetSessionStatus() == web::http::Session::Status::InProgress);
+
+		server.release();
+		CHECK(!held->GetError());
+		CHECK(held->GetResponse().body() == "/hold");
+	}
+}
+
+int main() {
+	test_batch_bypasses_limiter();
+	return test::result();
+}
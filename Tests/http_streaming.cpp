@@ -0,0 +1,140 @@
+#include "test.h"
+#include "../Web/http_client.h"
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+A streamed body cut off by a connection reset on a reused keep-alive
+connection: the chunks already passed to the sink mustn't be passed
+again by a rerun of the request, so the sink sees every byte once and
+the session fails
+*********************************************************************/
+namespace {
+	namespace net = boost::asio;
+	namespace beast = boost::beast;
+	using tcp = net::ip::tcp;
+
+	constexpr size_t BODY_SIZE{ 4 * web::http::Session::DEFAULT_CHUNK_SIZE },
+		SENT_BEFORE_RESET{ 3 * web::http::Session::DEFAULT_CHUNK_SIZE / 2 };	//More than a chunk: the sink gets one
+
+	string make_body() {
+		string body(BODY_SIZE, '\0');
+		for (size_t idx = 0; idx < BODY_SIZE; ++idx) {
+			body[idx] = static_cast<char>('a' + idx % 26 + idx / 26 % 7);		//A repeated chunk would break the pattern
+		}
+		return body;
+	}
+
+	/*********************************************************************
+	Serves a keep-alive connection: the first request gets a small
+	response, the second one part of the body followed by a reset, any
+	later one (a rerun on a new connection) the whole body
+	*********************************************************************/
+	class reset_server {
+	public:
+		explicit reset_server(const string& body)
+			: m_body{ body }, m_acceptor{ m_io, { net::ip::make_address("127.0.0.1"), 0 } }
+		{
+			m_thread = thread{ [this] { serve(); } };
+		}
+		~reset_server() {
+			m_stop = true;
+			beast::error_code error;
+			tcp::socket wake_up{ m_io };
+			wake_up.connect(m_acceptor.local_endpoint(), error);
+			m_thread.join();
+		}
+	public:
+		unsigned short port() const {
+			return m_acceptor.local_endpoint().port();
+		}
+		size_t requests() const noexcept {
+			return m_requests.load();
+		}
+	private:
+		void serve() {
+			while (!m_stop) {
+				tcp::socket socket{ m_io };
+				beast::error_code error;
+				m_acceptor.accept(socket, error);
+				beast::flat_buffer buffer;
+				while (!error && !m_stop) {
+					beast::http::request<beast::http::string_body> req;
+					beast::http::read(socket, buffer, req, error);
+					if (error) {
+						break;
+					}
+					const size_t number{ ++m_requests };
+					beast::http::response<beast::http::string_body> res{ beast::http::status::ok, 11 };
+					res.keep_alive(true);
+					if (number != 2) {
+						res.body() = number == 1 ? string{ "warm-up" } : m_body;
+						res.prepare_payload();
+						beast::http::write(socket, res, error);
+						continue;
+					}
+					res.content_length(m_body.size());
+					beast::http::response_serializer<beast::http::string_body> serializer{ res };
+					beast::http::write_header(socket, serializer, error);
+					net::write(socket, net::buffer(m_body.data(), SENT_BEFORE_RESET), error);
+					this_thread::sleep_for(chrono::milliseconds{ 100 });		//The client reads what was sent
+					socket.set_option(net::socket_base::linger{ true, 0 }, error);
+					socket.close(error);										//RST: connection_reset on the client
+				}
+			}
+		}
+	private:
+		const string& m_body;
+		net::io_context m_io;
+		tcp::acceptor m_acceptor;
+		atomic<bool> m_stop{ false };
+		atomic<size_t> m_requests{ 0 };
+		thread m_thread;
+	};
+
+	web::http::request make_request(const string& target, unsigned short port) {
+		web::http::request req{ web::http::method::get, target, 11 };
+		req.set(web::http::field::host, "127.0.0.1");
+		req.set(web::http::field::protocol, to_string(port));
+		req.keep_alive(true);
+		return req;
+	}
+
+	void test_reset_mid_body() {
+		const string body{ make_body() };
+		reset_server server{ body };
+		web::http::ClientSettings settings;
+		settings.io_threads = 1;												//One connection pool: the second request reuses the connection
+		settings.retry.initial_backoff = settings.retry.max_backoff = chrono::milliseconds{ 1 };
+		web::http::Client client{ settings };
+
+		const auto warm_up{ client.SendRequest(make_request("/warm-up", server.port())) };
+		CHECK(!warm_up->GetError());
+
+		string received;
+		const auto session{ client.StreamRequest(make_request("/body", server.port()), [&received](string_view chunk) {
+			received.append(chunk);
+			return true;
+		}) };
+		CHECK(session->GetError());
+		CHECK(!received.empty());
+		CHECK(received.size() <= SENT_BEFORE_RESET);
+		CHECK(body.compare(0, received.size(), received) == 0);
+		CHECK(server.requests() == 2);
+	}
+}
+
+int main() {
+	test_reset_mid_body();
+	return test::result();
+}
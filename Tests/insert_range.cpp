@@ -0,0 +1,78 @@
+#include "test.h"
+#include "../Containers/flat_map.h"
+#include "../Containers/flat_set.h"
+#include "../Containers/universal_container_insert.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+insert_range() into every ordered container: an lvalue range is left
+unchanged, the elements of an rvalue range are moved
+*********************************************************************/
+namespace {
+	const string LONG_TEXT(64, 't');											//Beyond the small string buffer: a move empties it
+
+	vector<string> make_keys() {
+		return { LONG_TEXT + "c", LONG_TEXT + "a", LONG_TEXT + "b" };
+	}
+	vector<pair<string, string>> make_pairs() {
+		vector<pair<string, string>> pairs;
+		for (const string& key : make_keys()) {
+			pairs.emplace_back(key, key + "-value");
+		}
+		return pairs;
+	}
+
+	bool moved_from(const string& value) {
+		return value.empty();
+	}
+	bool moved_from(const pair<string, string>& value) {
+		return value.first.empty() && value.second.empty();
+	}
+
+	bool same_value(const string& lhs, const string& rhs) {
+		return lhs == rhs;
+	}
+	template <class Lhs, class Rhs>
+	bool same_value(const Lhs& lhs, const Rhs& rhs) {							//Pairs of different types (e.g. flat_map proxies)
+		return lhs.first == rhs.first && lhs.second == rhs.second;
+	}
+
+	template <class Container, class Source>
+	void check_insert_range(const Source& expected) {
+		Container cont;
+		Source source{ expected };
+		container::insert_range(cont, source);
+		CHECK(source == expected);
+		CHECK(cont.size() == expected.size());
+		CHECK(is_permutation(cont.begin(), cont.end(), expected.begin(), expected.end(), [](const auto& lhs, const auto& rhs) {
+			return same_value(lhs, rhs);
+		}));
+
+		Container moved_into;
+		container::insert_range(moved_into, move(source));
+		CHECK(moved_into.size() == expected.size());
+		CHECK(all_of(source.begin(), source.end(), [](const auto& value) { return moved_from(value); }));
+	}
+}
+
+int main() {
+	const auto keys{ make_keys() };
+	check_insert_range<set<string>>(keys);
+	check_insert_range<multiset<string>>(keys);
+	check_insert_range<container::flat_set<string>>(keys);
+
+	const auto pairs{ make_pairs() };
+	check_insert_range<map<string, string>>(pairs);
+	check_insert_range<multimap<string, string>>(pairs);
+	check_insert_range<container::flat_map<string, string>>(pairs);
+	return test::result();
+}
@@ -0,0 +1,165 @@
+#include "test.h"
+#include "../MemoryManagement/object_pool.h"
+#include "../MemoryManagement/block_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+ObjectPool: objects are reused instead of being constructed again, the
+reset hook runs on every return and a throwing one drops the object,
+the shared list keeps at most max_idle objects, reserve() fills it up,
+and several threads recycle objects through the BlockPoolAllocator
+variant without sharing one or losing one
+*********************************************************************/
+namespace {
+	constexpr size_t THREAD_COUNT{ 4 },
+		ITERATIONS_PER_THREAD{ 20000 };
+
+	struct counted {
+		static inline atomic<size_t> constructed{ 0 }, destroyed{ 0 };
+
+		counted() noexcept : counted(0) {}
+		explicit counted(int number) noexcept : value{ number } { ++constructed; }
+		counted(const counted&) = delete;
+		counted& operator=(const counted&) = delete;
+		~counted() { ++destroyed; }
+
+		int value;
+		atomic<size_t> owners{ 0 };												//Handles holding the object at once
+	};
+
+	size_t alive() noexcept {
+		return counted::constructed - counted::destroyed;
+	}
+
+	void test_reuse_and_reset() {
+		size_t resets{ 0 };
+		memory::ObjectPool<counted> pool{ [&resets](counted& object) {
+			++resets;
+			object.value = 0;
+		} };
+		const size_t constructed{ counted::constructed };
+		counted* first;
+		{
+			auto handle{ pool.acquire(7) };
+			CHECK(handle->value == 7);
+			first = handle.get();
+		}
+		CHECK(resets == 1);
+		CHECK(pool.idle_count() == 1);
+
+		auto handle{ pool.acquire(8) };											//The argument is unused: nothing is constructed
+		CHECK(handle.get() == first);
+		CHECK(handle->value == 0);
+		CHECK(counted::constructed == constructed + 1);
+
+		handle.reset();															//Ahead of time
+		CHECK(!handle);
+		CHECK(resets == 2);
+		CHECK(pool.idle_count() == 1);
+	}
+
+	void test_throwing_reset_hook() {
+		memory::ObjectPool<counted> pool{ [](counted& object) {
+			if (object.value < 0) {
+				throw runtime_error("unusable");
+			}
+		} };
+		const size_t destroyed{ counted::destroyed };
+		{
+			auto broken{ pool.acquire(-1) };
+			auto healthy{ pool.acquire(1) };
+		}
+		CHECK(counted::destroyed == destroyed + 1);								//The broken object is gone
+		CHECK(pool.idle_count() == 1);
+		CHECK(pool.acquire()->value == 1);
+	}
+
+	void test_max_idle() {
+		memory::ObjectPool<counted> pool{ {}, { 0, 2 } };						//No thread caches: every return reaches the shared list
+		const size_t destroyed{ counted::destroyed };
+		{
+			vector<memory::ObjectPool<counted>::Handle> handles;
+			for (int idx = 0; idx < 5; ++idx) {
+				handles.push_back(pool.acquire(idx));
+			}
+		}
+		CHECK(pool.idle_count() == 2);
+		CHECK(counted::destroyed == destroyed + 3);
+		pool.clear();
+		CHECK(pool.idle_count() == 0);
+		CHECK(counted::destroyed == destroyed + 5);
+	}
+
+	void test_reserve() {
+		const size_t constructed{ counted::constructed };
+		{
+			memory::ObjectPool<counted> pool{ {}, { 4, 8 } };
+			pool.reserve(5);
+			CHECK(pool.idle_count() == 5);
+			CHECK(counted::constructed == constructed + 5);
+			pool.reserve(3);													//Enough idle ones already
+			CHECK(pool.idle_count() == 5);
+			pool.reserve(20);													//Capped by max_idle
+			CHECK(pool.idle_count() == 8);
+			CHECK(counted::constructed == constructed + 8);
+
+			auto handle{ pool.acquire() };
+			CHECK(pool.idle_count() == 7);
+			CHECK(counted::constructed == constructed + 8);
+		}
+		CHECK(counted::constructed == constructed + 8);
+		CHECK(alive() == 0);													//Idle objects die with the pool
+	}
+
+	void test_concurrent_block_pool() {
+		using allocator_type = memory::BlockPoolAllocator<counted>;
+		const auto blocks{ make_shared<memory::BlockPool>() };
+		atomic<size_t> shared_objects{ 0 };
+		{
+			memory::ObjectPool<counted, allocator_type> pool{ {}, { 8, 64 }, allocator_type{ blocks } };
+			vector<thread> threads;
+			for (size_t thread_idx = 0; thread_idx < THREAD_COUNT; ++thread_idx) {
+				threads.emplace_back([&pool, &shared_objects] {
+					for (size_t idx = 0; idx < ITERATIONS_PER_THREAD; ++idx) {
+						auto first{ pool.acquire() }, second{ pool.acquire() };
+						for (auto* handle : { &first, &second }) {
+							if (++(*handle)->owners != 1) {
+								++shared_objects;
+							}
+						}
+						this_thread::yield();
+						--first->owners;
+						--second->owners;
+						if (idx % 3 == 0) {
+							first.reset();										//Out of order returns
+						}
+					}
+				});
+			}
+			for (auto& worker : threads) {
+				worker.join();
+			}
+			CHECK(alive() == pool.idle_count());								//Every object came back
+		}
+		CHECK(shared_objects == 0);
+		CHECK(alive() == 0);
+	}
+}
+
+int main() {
+	test_reuse_and_reset();
+	test_throwing_reset_hook();
+	test_max_idle();
+	test_reserve();
+	test_concurrent_block_pool();
+	return test::result();
+}
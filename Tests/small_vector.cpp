@@ -0,0 +1,158 @@
+#include "test.h"
+#include "../Containers/small_vector.h"
+#include "../Containers/container_traits.h"
+#include "../Containers/universal_container_insert.h"
+
+#include <string>
+#include <vector>
+#include <utility>
+
+using namespace std;
+using namespace utility;
+
+/*********************************************************************
+small_vector: the spill from the inline buffer to the heap and back by
+shrink_to_fit(), an element of its own passed to emplace_back() during
+growth, moves and swaps between inline and heap storage, and
+insert_range() picking the linear path with reserve()
+*********************************************************************/
+namespace {
+	using vector_type = container::small_vector<string, 4>;
+
+	static_assert(container::is_linear_v<vector_type>);
+	static_assert(container::has_reserve_v<vector_type>);
+
+	const string LONG_TEXT(64, 't');											//Beyond the small string buffer: a move empties it
+
+	string make_value(size_t idx) {
+		return LONG_TEXT + to_string(idx);
+	}
+	vector_type make_vector(size_t count) {
+		vector_type result;
+		for (size_t idx = 0; idx < count; ++idx) {
+			result.push_back(make_value(idx));
+		}
+		return result;
+	}
+	bool holds_sequence(const vector_type& values, size_t count) {
+		if (values.size() != count) {
+			return false;
+		}
+		for (size_t idx = 0; idx < count; ++idx) {
+			if (values[idx] != make_value(idx)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void test_spill_and_shrink() {
+		vector_type values;
+		CHECK(values.is_inline());
+		CHECK(values.capacity() == 4);
+		values = make_vector(4);
+		CHECK(values.is_inline());
+		CHECK(holds_sequence(values, 4));
+
+		values.push_back(make_value(4));
+		CHECK(!values.is_inline());
+		CHECK(values.capacity() == 8);
+		CHECK(holds_sequence(values, 5));
+
+		values.shrink_to_fit();													//Still too many for the inline buffer
+		CHECK(!values.is_inline());
+		CHECK(values.capacity() == 5);
+		CHECK(holds_sequence(values, 5));
+
+		values.pop_back();
+		values.pop_back();
+		values.shrink_to_fit();
+		CHECK(values.is_inline());
+		CHECK(values.capacity() == 4);
+		CHECK(holds_sequence(values, 3));
+	}
+
+	void test_emplace_own_element() {
+		vector_type values{ make_vector(4) };
+		values.emplace_back(values[1]);											//Inline to heap
+		CHECK(!values.is_inline());
+		CHECK(values.size() == 5);
+		CHECK(values.back() == make_value(1));
+		CHECK(values[1] == make_value(1));
+
+		while (values.size() < values.capacity()) {
+			values.push_back(make_value(values.size()));
+		}
+		const size_t full{ values.size() };
+		values.emplace_back(values[0]);											//Heap to a bigger heap
+		CHECK(values.size() == full + 1);
+		CHECK(values.back() == make_value(0));
+		CHECK(values[0] == make_value(0));
+
+		values.push_back(values[2]);
+		CHECK(values.back() == make_value(2));
+	}
+
+	void test_move_and_swap() {
+		vector_type small{ make_vector(3) }, large{ make_vector(6) };
+		swap(small, large);
+		CHECK(holds_sequence(small, 6));
+		CHECK(!small.is_inline());
+		CHECK(holds_sequence(large, 3));
+		CHECK(large.is_inline());
+
+		small.swap(large);
+		CHECK(holds_sequence(small, 3));
+		CHECK(holds_sequence(large, 6));
+
+		vector_type other{ make_vector(2) };
+		other.swap(small);														//Both inline
+		CHECK(holds_sequence(other, 3));
+		CHECK(holds_sequence(small, 2));
+
+		const string* heap_data{ large.data() };
+		vector_type stolen{ move(large) };										//The heap buffer changes hands
+		CHECK(stolen.data() == heap_data);
+		CHECK(holds_sequence(stolen, 6));
+		CHECK(large.empty());
+		CHECK(large.is_inline());
+
+		vector_type copied{ move(other) };										//Inline: the elements are moved one by one
+		CHECK(copied.is_inline());
+		CHECK(holds_sequence(copied, 3));
+		CHECK(other.empty());
+
+		copied = move(stolen);
+		CHECK(!copied.is_inline());
+		CHECK(holds_sequence(copied, 6));
+		stolen = move(small);
+		CHECK(stolen.is_inline());
+		CHECK(holds_sequence(stolen, 2));
+	}
+
+	void test_insert_range() {
+		vector_type values{ make_vector(2) };
+		const vector<string> source{ make_value(2), make_value(3), make_value(4) };
+		container::insert_range(values, source);
+		CHECK(holds_sequence(values, 5));
+		CHECK(source[0] == make_value(2));										//An lvalue range is left intact
+
+		vector<string> moved{ make_value(5), make_value(6) };
+		container::insert_range(values, move(moved));
+		CHECK(holds_sequence(values, 7));
+		CHECK(moved[0].empty());
+
+		vector_type other{ make_vector(1) };
+		container::insert_range(other, vector_type{ make_value(1), make_value(2) });
+		CHECK(other.is_inline());
+		CHECK(holds_sequence(other, 3));
+	}
+}
+
+int main() {
+	test_spill_and_shrink();
+	test_emplace_own_element();
+	test_move_and_swap();
+	test_insert_range();
+	return test::result();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+/*********************************************************************
+Minimal test harness: CHECK() reports a failed condition and keeps
+going, so one run shows every failure (unlike assert(), it also works
+in release builds); a test returns test::result() from main()
+*********************************************************************/
+namespace utility::test {
+	inline int& failures() noexcept {
+		static int count{ 0 };
+		return count;
+	}
+
+	inline void check(bool condition, const char* text, const char* file, int line) noexcept {
+		if (!condition) {
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, text);
+			++failures();
+		}
+	}
+
+	inline int result() noexcept {
+		return failures() ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+}
+
+#define CHECK(condition) ::utility::test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
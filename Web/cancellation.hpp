@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace utility::concurrency {
+class TaskCancelled : public std::runtime_error {
+ public:
+  TaskCancelled() : std::runtime_error("Task was cancelled") {}
+};
+
+/*********************************************************************
+Cooperative cancellation: a source owns the flag, any number of tokens
+observe it. Nothing is interrupted forcibly - a long-running task is
+expected to poll Cancelled() and return early (or ThrowIfCancelled())
+*********************************************************************/
+class CancellationToken {
+ public:
+  CancellationToken() noexcept = default;  // Never cancelled
+
+  bool Cancelled() const noexcept {
+    return m_state && m_state->load(std::memory_order_acquire);
+  }
+
+  void ThrowIfCancelled() const {
+    if (Cancelled()) {
+      throw TaskCancelled{};
+    }
+  }
+
+  bool CanBeCancelled() const noexcept { return static_cast<bool>(m_state); }
+
+ private:
+  friend class CancellationSource;
+
+  explicit CancellationToken(
+      std::shared_ptr<const std::atomic<bool>> state) noexcept
+      : m_state{std::move(state)} {}
+
+ private:
+  std::shared_ptr<const std::atomic<bool>> m_state;
+};
+
+class CancellationSource {
+ public:
+  CancellationSource() : m_state{std::make_shared<std::atomic<bool>>(false)} {}
+
+  void Cancel() noexcept { m_state->store(true, std::memory_order_release); }
+
+  bool Cancelled() const noexcept {
+    return m_state->load(std::memory_order_acquire);
+  }
+
+  CancellationToken GetToken() const noexcept {
+    return CancellationToken{m_state};
+  }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> m_state;
+};
+
+namespace details {
+// A callable that can't be invoked with the passed arguments as is, but
+// accepts a CancellationToken in front of them, gets the pool's token
+template <class Function, class... Types>
+inline constexpr bool takes_cancellation_token_v =
+    !std::is_invocable_v<Function, Types...> &&
+    std::is_invocable_v<Function, CancellationToken, Types...>;
+}  // namespace details
+}  // namespace utility::concurrency
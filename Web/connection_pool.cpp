@@ -0,0 +1,274 @@
+#include "connection_pool.h"
+
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/ssl/error.hpp>
+
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+
+#include <ctime>
+#include <utility>
+
+using namespace std;
+
+namespace web::http {
+ConnectionPool::ConnectionPool(
+    boost::asio::io_context& io,
+    ConnectionPoolSettings settings,
+    shared_ptr<boost::asio::ssl::context> tls_context)
+    : m_io{io},
+      m_settings{settings},
+      m_tls_context{move(tls_context)},
+      m_last_sweep{clock_t::now()} {}
+
+string ConnectionPool::MakeHostKey(string_view host, string_view service) {
+  string host_key;
+  host_key.reserve(host.size() + service.size() + 1);
+  host_key.append(host).append(1, ':').append(service);
+  return host_key;
+}
+
+ConnectionPool::Service ConnectionPool::ParseService(
+    string_view protocol) noexcept {
+  constexpr string_view HTTP{"http"}, HTTPS{"https"};
+  const auto delimiter{protocol.find(':')};
+  const auto scheme{protocol.substr(0, delimiter)};
+  if (scheme != HTTP && scheme != HTTPS) {
+    return {protocol, false};
+  }
+  return {delimiter == string_view::npos ? scheme
+                                         : protocol.substr(delimiter + 1),
+          scheme == HTTPS};
+}
+
+void ConnectionPool::Acquire(const string& host_key,
+                             acquire_handler_t handler) {
+  connection_holder connection;
+  bool reused{false};
+  {
+    lock_guard lock(m_mtx);
+    const auto now{clock_t::now()};
+    sweep(now);
+    auto& host{m_hosts[host_key]};
+    evict_expired(host, now);
+    while (!host.idle.empty() && !connection) {
+      connection_holder candidate{move(host.idle.back())};
+      host.idle.pop_back();
+      if (alive(*candidate)) {
+        connection = move(candidate);
+        reused = true;
+      } else {
+        close(*candidate);
+        --host.total;
+      }
+    }
+    if (!connection) {
+      if (host.total >= m_settings.max_total_per_host) {
+        host.waiters.push_back(move(handler));
+        return;
+      }
+      connection = make_connection();
+      ++host.total;
+    }
+  }
+  handler(move(connection), reused);
+}
+
+void ConnectionPool::Release(const string& host_key,
+                             connection_holder connection) {
+  connection->stream.expires_never();
+  auto tls_session{get_tls_session(*connection)};
+  acquire_handler_t waiter;
+  {
+    lock_guard lock(m_mtx);
+    auto& host{m_hosts[host_key]};
+    if (tls_session) {
+      host.tls_session = move(tls_session);
+    }
+    if (host.waiters.empty()) {
+      const auto now{clock_t::now()};
+      if (host.idle.size() < m_settings.max_idle_per_host) {
+        connection->idle_since = now;
+        host.idle.push_back(move(connection));
+      } else {
+        close(*connection);
+        --host.total;
+      }
+      sweep(now);
+      return;
+    }
+    waiter = move(host.waiters.front());
+    host.waiters.pop_front();
+  }
+  hand_over(move(waiter), move(connection), true);
+}
+
+void ConnectionPool::Discard(const string& host_key,
+                             connection_holder connection) {
+  auto tls_session{get_tls_session(*connection)};
+  close(*connection);
+  connection.reset();
+  acquire_handler_t waiter;
+  {
+    lock_guard lock(m_mtx);
+    auto& host{m_hosts[host_key]};
+    if (tls_session) {
+      host.tls_session = move(tls_session);
+    }
+    if (host.waiters.empty()) {
+      --host.total;
+      return;
+    }
+    waiter = move(host.waiters.front());
+    host.waiters.pop_front();
+    connection = make_connection();  // Takes the slot of the closed one
+  }
+  hand_over(move(waiter), move(connection), false);
+}
+
+ConnectionPool::error_code ConnectionPool::StartTls(const string& host_key,
+                                                   const string& server_name,
+                                                   Connection& connection) {
+  if (!m_tls_context) {
+    return boost::asio::error::operation_not_supported;
+  }
+  auto* tls{connection.tls.emplace(connection.stream, *m_tls_context)
+                .native_handle()};
+  error_code error;
+  boost::asio::ip::make_address(server_name, error);
+  const bool configured{
+      error ? SSL_set_tlsext_host_name(tls, server_name.c_str()) == 1 &&
+                  SSL_set1_host(tls, server_name.c_str()) == 1
+            : X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(tls),
+                                            server_name.c_str()) ==
+                  1};  // No SNI for addresses
+  if (!configured) {
+    return {static_cast<int>(ERR_get_error()),
+            boost::asio::error::get_ssl_category()};
+  }
+  lock_guard lock(m_mtx);
+  if (const auto it = m_hosts.find(host_key);
+      it != m_hosts.end() && it->second.tls_session) {
+    SSL_set_session(tls, it->second.tls_session.get());  // Takes a reference
+  }
+  return {};
+}
+
+void ConnectionPool::Clear() {
+  lock_guard lock(m_mtx);
+  for (auto& [host_key, host] : m_hosts) {
+    for (auto& connection : host.idle) {
+      close(*connection);
+    }
+    host.total -= host.idle.size();
+    host.idle.clear();
+  }
+}
+
+size_t ConnectionPool::IdleConnections() const {
+  lock_guard lock(m_mtx);
+  size_t idle_count{0};
+  for (const auto& [host_key, host] : m_hosts) {
+    idle_count += host.idle.size();
+  }
+  return idle_count;
+}
+
+size_t ConnectionPool::OpenConnections() const {
+  lock_guard lock(m_mtx);
+  size_t total_count{0};
+  for (const auto& [host_key, host] : m_hosts) {
+    total_count += host.total;
+  }
+  return total_count;
+}
+
+bool ConnectionPool::alive(Connection& connection) noexcept {
+  auto& socket{connection.stream.socket()};
+  if (!socket.is_open() || connection.buffer.size() != 0) {
+    return false;
+  }
+  boost::system::error_code error, mode_error;
+  socket.non_blocking(true, mode_error);
+  if (mode_error) {
+    return false;
+  }
+  char byte;
+  socket.receive(boost::asio::buffer(&byte, 1),
+                 boost::asio::socket_base::message_peek,
+                 error);  // EOF or data nobody asked for - unusable
+  socket.non_blocking(false, mode_error);
+  return error == boost::asio::error::would_block && !mode_error;
+}
+
+void ConnectionPool::close(Connection& connection) noexcept {
+  if (connection.tls) {  // Otherwise OpenSSL invalidates the session when
+    SSL_set_shutdown(    // the connection is freed without close_notify
+        connection.tls->native_handle(),
+        SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  }
+  boost::system::error_code error;
+  connection.stream.socket().shutdown(
+      boost::asio::ip::tcp::socket::shutdown_both, error);
+  connection.stream.close();
+}
+
+bool ConnectionPool::resumable(
+    const tls_session_holder& tls_session) noexcept {
+  if (!tls_session || SSL_SESSION_is_resumable(tls_session.get()) != 1) {
+    return false;
+  }
+  return SSL_SESSION_get_time(tls_session.get()) +
+             SSL_SESSION_get_timeout(tls_session.get()) >
+         time(nullptr);
+}
+
+ConnectionPool::tls_session_holder ConnectionPool::get_tls_session(
+    Connection& connection) noexcept {
+  if (!connection.tls) {
+    return nullptr;
+  }
+  tls_session_holder tls_session{
+      SSL_get1_session(connection.tls->native_handle())};
+  return resumable(tls_session) ? move(tls_session) : nullptr;
+}
+
+void ConnectionPool::evict_expired(Host& host, clock_t::time_point now) {
+  while (!host.idle.empty() &&
+         now - host.idle.front()->idle_since >= m_settings.idle_timeout) {
+    close(*host.idle.front());
+    host.idle.pop_front();
+    --host.total;
+  }
+}
+
+void ConnectionPool::sweep(clock_t::time_point now) {
+  if (now - m_last_sweep < m_settings.idle_timeout) {
+    return;
+  }
+  m_last_sweep = now;
+  for (auto it = m_hosts.begin(); it != m_hosts.end();) {
+    evict_expired(it->second, now);
+    if (it->second.total == 0 && it->second.waiters.empty() &&
+        !resumable(it->second.tls_session)) {
+      it = m_hosts.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ConnectionPool::hand_over(acquire_handler_t handler,
+                               connection_holder connection,
+                               bool reused) {
+  boost::asio::post(m_io, [handler = move(handler),
+                           connection = move(connection), reused]() mutable {
+    handler(move(connection), reused);
+  });
+}
+
+connection_holder ConnectionPool::make_connection() {
+  return make_unique<Connection>(m_io);
+}
+}  // namespace web::http
@@ -0,0 +1,150 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/ssl/ssl_stream.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace web::http {
+struct Connection {
+  using executor_type =  // Not type-erased: copying any_io_executor
+      boost::asio::io_context::executor_type;  // allocates
+  using stream_type =
+      boost::beast::basic_stream<boost::asio::ip::tcp, executor_type>;
+  using tls_stream_type = boost::beast::ssl_stream<stream_type&>;
+
+  explicit Connection(boost::asio::io_context& io)
+      : stream(io.get_executor()) {}
+
+  template <class Visitor>
+  void VisitStream(Visitor&& visitor) {  // Gets the TLS layer if there's one
+    if (tls) {
+      visitor(*tls);
+    } else {
+      visitor(stream);
+    }
+  }
+
+  stream_type stream;  // The io_context is run by a single thread, so
+                       // handlers and the timeout never overlap
+  std::optional<tls_stream_type> tls;  // Over the stream, set by StartTls()
+  boost::beast::flat_buffer buffer;  // Bytes read ahead belong to the socket
+  std::chrono::steady_clock::time_point idle_since;
+};
+
+using connection_holder = std::unique_ptr<Connection>;
+
+struct ConnectionPoolSettings {
+  size_t max_idle_per_host{8},
+      max_total_per_host{32};  // Acquire() is queued above the limit
+  std::chrono::seconds idle_timeout{30};
+};
+
+/*********************************************************************
+Keep-alive connections grouped by "host:service". An idle connection is
+checked before reuse: if the peer has closed it (or sent something
+unsolicited) it's evicted and another one is tried. The most recently
+used connection is reused first, so the surplus ones expire after
+idle_timeout; expired connections are swept lazily by Acquire()/Release().
+TLS connections are pooled with the handshake done. Besides, the pool
+keeps the last TLS session of each host: new connections resume it with
+an abbreviated handshake as long as the server accepts the ticket
+*********************************************************************/
+class ConnectionPool {
+ public:
+  using clock_t = std::chrono::steady_clock;
+  using error_code = boost::beast::error_code;
+  using acquire_handler_t =
+      std::function<void(connection_holder connection, bool reused)>;
+
+  struct Service {
+    std::string_view name;  // For the resolver
+    bool secure;
+  };
+
+ public:
+  ConnectionPool(boost::asio::io_context& io,
+                 ConnectionPoolSettings settings,
+                 std::shared_ptr<boost::asio::ssl::context> tls_context =
+                     nullptr);  // Shared by TLS connections, HTTPS needs it
+
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+  static std::string MakeHostKey(std::string_view host,
+                                 std::string_view service);
+
+  // "https[:port]" stands for TLS, "http[:port]" or a bare service - for
+  // plain TCP
+  static Service ParseService(std::string_view protocol) noexcept;
+
+  // The handler gets either a connected idle socket (reused == true) or a
+  // new unconnected one. It's invoked in place if the host is below its
+  // limit, otherwise posted to the io_context once a connection is freed
+  void Acquire(const std::string& host_key, acquire_handler_t handler);
+
+  void Release(const std::string& host_key,
+               connection_holder connection);  // Back to the idle list
+  void Discard(const std::string& host_key,
+               connection_holder connection);  // Closes the socket
+
+  // Puts TLS over a new connected socket before the handshake: sets the
+  // name expected in the certificate (and SNI) and the session to resume
+  error_code StartTls(const std::string& host_key,
+                      const std::string& server_name,
+                      Connection& connection);
+
+  void Clear();  // Closes idle connections
+
+  size_t IdleConnections() const;
+  size_t OpenConnections() const;  // Idle and in use
+
+ private:
+  struct TlsSessionDeleter {
+    void operator()(SSL_SESSION* tls_session) const noexcept {
+      SSL_SESSION_free(tls_session);
+    }
+  };
+
+  using tls_session_holder = std::unique_ptr<SSL_SESSION, TlsSessionDeleter>;
+
+  struct Host {
+    std::deque<connection_holder> idle;  // The most recent is at the back
+    std::deque<acquire_handler_t> waiters;
+    size_t total{0};
+    tls_session_holder tls_session;  // The host outlives its connections
+  };                                 // while it's resumable
+
+ private:
+  static bool alive(Connection& connection) noexcept;
+  static void close(Connection& connection) noexcept;
+  static bool resumable(const tls_session_holder& tls_session) noexcept;
+  static tls_session_holder get_tls_session(
+      Connection& connection) noexcept;  // Null if there's nothing to resume
+
+  void evict_expired(Host& host, clock_t::time_point now);
+  void sweep(clock_t::time_point now);  // Caller holds the lock
+  void hand_over(acquire_handler_t handler,
+                 connection_holder connection,
+                 bool reused);
+  connection_holder make_connection();
+
+ private:
+  boost::asio::io_context& m_io;
+  const ConnectionPoolSettings m_settings;
+  const std::shared_ptr<boost::asio::ssl::context> m_tls_context;
+  mutable std::mutex m_mtx;
+  std::unordered_map<std::string, Host> m_hosts;
+  clock_t::time_point m_last_sweep;
+};
+}  // namespace web::http
@@ -0,0 +1,318 @@
+#pragma once
+#include "thread_pool.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/is_executor.hpp>
+#include <boost/asio/post.hpp>
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/*C++20 or newer needed*/
+namespace utility::concurrency {
+namespace coro {
+template <class Ty = void>
+class Task;
+
+namespace details {
+class PromiseBase {
+ private:
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> coroutine) noexcept {
+      return static_cast<PromiseBase&>(coroutine.promise())
+          .m_continuation;  // Symmetric transfer to the awaiting coroutine
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+ public:
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+
+  void unhandled_exception() noexcept {
+    m_exception = std::current_exception();
+  }
+
+  void SetContinuation(std::coroutine_handle<> continuation) noexcept {
+    m_continuation = continuation;
+  }
+
+ protected:
+  void rethrow_if_failed() const {
+    if (m_exception) {
+      std::rethrow_exception(m_exception);
+    }
+  }
+
+ private:
+  std::coroutine_handle<> m_continuation{std::noop_coroutine()};
+  std::exception_ptr m_exception;
+};
+
+template <class Ty>
+class Promise : public PromiseBase {
+ public:
+  Task<Ty> get_return_object() noexcept;
+
+  template <class Value,
+            std::enable_if_t<std::is_convertible_v<Value&&, Ty>, int> = 0>
+  void return_value(Value&& value) {
+    m_value.emplace(std::forward<Value>(value));
+  }
+
+  Ty ExtractResult() {
+    rethrow_if_failed();
+    return std::move(*m_value);
+  }
+
+ private:
+  std::optional<Ty> m_value;
+};
+
+template <>
+class Promise<void> : public PromiseBase {
+ public:
+  Task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+
+  void ExtractResult() const { rethrow_if_failed(); }
+};
+
+struct DetachedCoroutine {  // The frame is destroyed on completion
+  struct promise_type {
+    DetachedCoroutine get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept {
+    }  // Dropped exactly as async::DetachedTask does
+  };
+};
+
+template <class Ty>
+DetachedCoroutine run_detached(Task<Ty> task) {
+  co_await std::move(task);
+}
+
+template <class Ty>
+DetachedCoroutine run_into_promise(Task<Ty> task, std::promise<Ty> promise) {
+  try {
+    if constexpr (std::is_void_v<Ty>) {
+      co_await std::move(task);
+      promise.set_value();
+    } else {
+      promise.set_value(co_await std::move(task));
+    }
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+}
+}  // namespace details
+
+/*********************************************************************
+Lazy coroutine: the body starts only when the task is awaited (or passed
+to Spawn()/SyncWait()) and resumes the awaiting coroutine on completion
+via symmetric transfer, so chains of tasks don't grow the stack and don't
+allocate anything beyond their own frames
+*********************************************************************/
+template <class Ty>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = details::Promise<Ty>;
+  using value_type = Ty;
+
+ private:
+  using handle_t = std::coroutine_handle<promise_type>;
+
+  class Awaiter {
+   public:
+    explicit Awaiter(handle_t coroutine) noexcept : m_coroutine{coroutine} {}
+
+    bool await_ready() const noexcept { return m_coroutine.done(); }
+
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<> awaiting) noexcept {
+      m_coroutine.promise().SetContinuation(awaiting);
+      return m_coroutine;
+    }
+
+    Ty await_resume() { return m_coroutine.promise().ExtractResult(); }
+
+   private:
+    handle_t m_coroutine;
+  };
+
+ public:
+  Task() noexcept = default;
+  explicit Task(handle_t coroutine) noexcept : m_coroutine{coroutine} {}
+  Task(const Task&) = delete;
+  Task(Task&& other) noexcept
+      : m_coroutine{std::exchange(other.m_coroutine, nullptr)} {}
+  Task& operator=(const Task&) = delete;
+  Task& operator=(Task&& other) noexcept {
+    if (this != std::addressof(other)) {
+      destroy();
+      m_coroutine = std::exchange(other.m_coroutine, nullptr);
+    }
+    return *this;
+  }
+  ~Task() { destroy(); }
+
+  bool Valid() const noexcept { return static_cast<bool>(m_coroutine); }
+  bool Done() const noexcept { return Valid() && m_coroutine.done(); }
+
+  Awaiter operator co_await() && noexcept {  //Task must be valid
+    return Awaiter{m_coroutine};
+  }
+
+ private:
+  void destroy() noexcept {
+    if (m_coroutine) {
+      m_coroutine.destroy();
+    }
+  }
+
+ private:
+  handle_t m_coroutine{nullptr};
+};
+
+namespace details {
+template <class Ty>
+Task<Ty> Promise<Ty>::get_return_object() noexcept {
+  return Task<Ty>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+  return Task<void>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+}  // namespace details
+
+template <class Executor>
+class ExecutorAwaiter {  // Resumes the coroutine inside a boost::asio context
+ public:
+  explicit ExecutorAwaiter(Executor executor) noexcept
+      : m_executor(std::move(executor)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> coroutine) const {
+    boost::asio::post(m_executor, [coroutine]() { coroutine.resume(); });
+  }
+
+  void await_resume() const noexcept {}
+
+ private:
+  Executor m_executor;
+};
+
+template <class Initiation, class... Types>
+class CallbackAwaiter {
+ public:
+  using result_t = std::tuple<Types...>;
+
+ public:
+  explicit CallbackAwaiter(Initiation initiation)
+      : m_initiation(std::move(initiation)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> coroutine) {
+    std::invoke(std::move(m_initiation),
+                [this, coroutine](auto&&... results) {
+                  m_results.emplace(
+                      std::forward<decltype(results)>(results)...);
+                  coroutine.resume();
+                });
+  }
+
+  result_t await_resume() { return std::move(*m_results); }
+
+ private:
+  Initiation m_initiation;
+  std::optional<result_t> m_results;
+};
+
+inline ThreadPool::ScheduleAwaiter Schedule(ThreadPool& pool) noexcept {
+  return pool.Schedule();
+}
+
+template <class Executor,
+          std::enable_if_t<boost::asio::execution::is_executor_v<Executor> ||
+                               boost::asio::is_executor<Executor>::value,
+                           int> = 0>
+ExecutorAwaiter<Executor> Schedule(const Executor& executor) {
+  return ExecutorAwaiter<Executor>{executor};
+}
+
+inline auto Schedule(boost::asio::io_context& io) {
+  return Schedule(io.get_executor());
+}
+
+/*********************************************************************
+Adapts any callback-based operation, e.g. boost::asio async_* calls:
+auto [ec, bytes] = co_await FromCallback<error_code, size_t>(
+    [&](auto handler) { http::async_write(stream, req, std::move(handler)); });
+The coroutine is resumed on the thread which invokes the handler
+*********************************************************************/
+template <class... Types, class Initiation>
+CallbackAwaiter<std::decay_t<Initiation>, Types...> FromCallback(
+    Initiation&& initiation) {
+  return CallbackAwaiter<std::decay_t<Initiation>, Types...>{
+      std::forward<Initiation>(initiation)};
+}
+
+template <class Function, class... Types>
+Task<std::invoke_result_t<Function, Types...>> Async(ThreadPool& pool,
+                                                     Function func,
+                                                     Types... args) {
+  co_await pool.Schedule();
+  co_return std::invoke(std::move(func), std::move(args)...);
+}
+
+template <class Ty>
+void Spawn(Task<Ty> task) {
+  details::run_detached(std::move(task));
+}
+
+template <class Ty>
+Ty SyncWait(Task<Ty> task) {
+  std::promise<Ty> promise;
+  auto future{promise.get_future()};
+  details::run_into_promise(std::move(task), std::move(promise));
+  return future.get();
+}
+}  // namespace coro
+
+class ControllerAwaiter {  // co_await controller waits for Stop() + NotifyAll()
+ public:
+  explicit ControllerAwaiter(ThreadController& controller) noexcept
+      : m_controller{controller} {}
+
+  bool await_ready() const noexcept { return m_controller.Stopped(); }
+
+  bool await_suspend(std::coroutine_handle<> coroutine) {
+    return m_controller.Subscribe([coroutine]() { coroutine.resume(); });
+  }
+
+  void await_resume() const noexcept {}
+
+ private:
+  ThreadController& m_controller;
+};
+
+inline ControllerAwaiter operator co_await(ThreadController& controller) {
+  return ControllerAwaiter{controller};
+}
+}  // namespace utility::concurrency
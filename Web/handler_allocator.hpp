@@ -0,0 +1,42 @@
+#pragma once
+#include "../MemoryManagement/block_pool.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace web::http {
+using handler_allocator_t = utility::memory::BlockPoolAllocator<std::byte>;
+
+// Associates an allocator with a completion handler: asio and beast take
+// the state of the operation from it instead of the heap. Stands in for
+// boost::asio::bind_allocator which appeared in Boost 1.79
+template <class Handler>
+class AllocatedHandler {
+ public:
+  using allocator_type = handler_allocator_t;
+
+ public:
+  AllocatedHandler(allocator_type allocator, Handler handler)
+      : m_allocator{std::move(allocator)}, m_handler{std::move(handler)} {}
+
+  allocator_type get_allocator() const noexcept { return m_allocator; }
+
+  template <class... Types>
+  auto operator()(Types&&... args)
+      -> decltype(std::declval<Handler&>()(std::forward<Types>(args)...)) {
+    return m_handler(std::forward<Types>(args)...);
+  }
+
+ private:
+  allocator_type m_allocator;
+  Handler m_handler;
+};
+
+template <class Handler>
+AllocatedHandler<std::decay_t<Handler>> BindAllocator(
+    handler_allocator_t allocator,
+    Handler&& handler) {
+  return {std::move(allocator), std::forward<Handler>(handler)};
+}
+}  // namespace web::http
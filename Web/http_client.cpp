@@ -1,14 +1,67 @@
 #include "http_client.h"
 
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/ssl/error.hpp>
+
 #include <algorithm>
 #include <functional>
+#include <limits>
 #include <numeric>
+#include <random>
 
 using namespace std;
 
 namespace web::http {
-Session::Session(request request, boost::asio::io_context& io)
-    : m_request{move(request)}, m_resolver(io), m_timer(io), m_tcp_stream(io) {}
+body_sink_t MakeFileSink(const string& path) {
+  auto file{make_shared<boost::beast::file>()};
+  boost::beast::error_code error;
+  file->open(path.c_str(), boost::beast::file_mode::write, error);
+  if (error) {
+    throw boost::system::system_error(error);
+  }
+  return [file](string_view chunk) {
+    boost::beast::error_code error;
+    while (!chunk.empty()) {
+      chunk.remove_prefix(file->write(chunk.data(), chunk.size(), error));
+      if (error) {
+        return false;
+      }
+    }
+    return true;
+  };
+}
+
+shared_ptr<boost::asio::ssl::context> MakeTlsContext() {
+  auto tls_context{make_shared<boost::asio::ssl::context>(
+      boost::asio::ssl::context::tls_client)};
+  tls_context->set_options(boost::asio::ssl::context::default_workarounds |
+                           boost::asio::ssl::context::no_sslv2 |
+                           boost::asio::ssl::context::no_sslv3 |
+                           boost::asio::ssl::context::no_tlsv1 |
+                           boost::asio::ssl::context::no_tlsv1_1);
+  tls_context->set_default_verify_paths();
+  tls_context->set_verify_mode(boost::asio::ssl::verify_peer);
+  return tls_context;
+}
+
+Session::Session(request request,
+                 boost::asio::io_context& io,
+                 shared_ptr<ConnectionPool> connections,
+                 shared_ptr<ResolverCache> resolver_cache,
+                 handler_allocator_t allocator)
+    : m_request{move(request)},
+      m_io{io},
+      m_resolver(io),
+      m_resolve_timer(io),
+      m_backoff_timer(io),
+      m_created{clock_t::now()},
+      m_resolver_cache{move(resolver_cache)},
+      m_connections{move(connections)},
+      m_host_key{ConnectionPool::MakeHostKey(
+          static_cast<string>(m_request[boost::beast::http::field::host]),
+          static_cast<string>(
+              m_request[boost::beast::http::field::protocol]))},
+      m_allocator{move(allocator)} {}
 
 Session::Status Session::GetSessionStatus() const noexcept {
   if (m_controller.InProgress()) {
@@ -27,8 +80,19 @@ const request& Session::GetRequest() const noexcept {
 }
 
 void Session::Wait() const {
-  if (!m_controller.Stopped()) {
-    m_controller.Wait();
+  m_controller.Wait();
+}
+
+void Session::OnComplete(completion_handler_t handler) {
+  utility::concurrency::ThreadController::callback_t callback{
+      [this, handler = move(handler)]() {
+        try {
+          handler(shared_from_this());  // Alive: the completing operation
+        } catch (...) {                 // holds a session_holder
+        }
+      }};
+  if (!m_controller.Subscribe(callback)) {
+    callback();
   }
 }
 
@@ -69,110 +133,749 @@ optional<ResultCodeCategory> Session::GetResultCodeCategory() const {
   return static_cast<ResultCodeCategory>(front_digit);
 }
 
+void Session::StreamBody(body_sink_t sink, size_t chunk_size) {
+  BOOST_ASSERT(sink);
+  if (!m_body_stream) {
+    m_body_stream = make_unique<BodyStream>();
+  }
+  m_body_stream->sink = move(sink);
+  m_body_stream->chunk.resize(max(chunk_size, size_t{1}));
+  m_body_stream->delivered = false;
+  reset_response();
+}
+
+void Session::SetTimeouts(const SessionTimeouts& timeouts) {
+  m_timeouts = timeouts;
+}
+
+void Session::SetRetryPolicy(const RetryPolicy& policy) {
+  m_retry_policy = policy;
+}
+
+void Session::SetHedging(const HedgingPolicy& policy) {
+  m_hedging = policy;
+}
+
+void Session::throw_if_failed() const {
+  if (m_error) {
+    throw runtime_error("HTTP session failed");
+  }
+}
+
+template <class Handler>
+auto Session::make_handler(session_holder&& session, Handler handler) {
+  auto allocator{session->m_allocator};
+  return BindAllocator(
+      move(allocator),
+      [session = move(session), handler](auto&&... args) mutable
+      -> decltype(handler(session_holder{},
+                          forward<decltype(args)>(args)...)) {  // SFINAE
+        handler(move(session), forward<decltype(args)>(args)...);
+      });
+}
+
 void Session::RunAsync(session_holder session) {
+  auto& io{session->m_io};  // In place if called by its thread
+  boost::asio::dispatch(
+      io, make_handler(move(session), [](session_holder session) {
+        start(move(session));
+      }));
+}
+
+void Session::start(session_holder session) {
+  if (session->hedged()) {
+    start_hedged(move(session));
+  } else if (auto connections{session->m_connections}) {
+    connections->Acquire(
+        session->m_host_key,
+        [session](connection_holder connection, bool reused) mutable {
+          on_acquire(move(session), move(connection), reused);
+        });
+  } else {
+    auto connection{make_unique<Connection>(session->m_io)};
+    on_acquire(move(session), move(connection), false);
+  }
+}
+
+ConnectionPool::Service Session::service() const noexcept {
+  const auto protocol{m_request[boost::beast::http::field::protocol]};
+  return ConnectionPool::ParseService({protocol.data(), protocol.size()});
+}
+
+void Session::reuse(request&& req) {
+  m_request = move(req);
+  m_host_key = ConnectionPool::MakeHostKey(
+      static_cast<string>(m_request[boost::beast::http::field::host]),
+      static_cast<string>(m_request[boost::beast::http::field::protocol]));
+  m_created = clock_t::now();
+  m_controller.Continue();
+}
+
+bool Session::clear() noexcept {
+  if (m_controller.InProgress() || m_connection) {
+    return false;  // Never started: callbacks may be subscribed
+  }
+  m_request = {};
+  m_response.base() = {};
+  if (m_response.body().capacity() > MAX_RETAINED_BODY) {
+    m_response.body() = {};
+  } else {
+    m_response.body().clear();
+  }
+  if (m_body_stream) {
+    m_body_stream->sink = nullptr;
+    m_body_stream->parser.reset();
+  }
+  if (m_hedge) {
+    m_hedge->running = 0;
+    m_hedge->settled = false;
+  }
+  m_timeouts = {};
+  m_retry_policy = {};
+  m_hedging = {};
+  m_attempt = 1;
+  m_reused = m_retried = false;
+  m_error = {};
+  return true;
+}
+
+bool Session::streaming() const noexcept {
+  return m_body_stream && m_body_stream->sink;
+}
+
+bool Session::idempotent(method verb) noexcept {
+  switch (verb) {
+    case method::get:
+    case method::head:
+    case method::options:
+    case method::trace:
+    case method::put:
+    case method::delete_:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool Session::transient(boost::beast::error_code error) noexcept {
+  return error == boost::asio::error::connection_refused ||
+         error == boost::asio::error::connection_reset ||
+         error == boost::asio::error::connection_aborted ||
+         error == boost::asio::error::timed_out ||
+         error == boost::asio::error::broken_pipe ||
+         error == boost::asio::error::eof ||
+         error == boost::asio::error::host_not_found_try_again ||
+         error == boost::asio::ssl::error::stream_truncated ||
+         error == boost::beast::http::error::end_of_stream ||
+         error == boost::beast::error::timeout;
+}
+
+void Session::complete(boost::beast::error_code error) {
+  m_error = error;
+  m_controller.Stop();
+  if (auto limiter{move(m_limiter)}) {
+    limiter->finish(m_host_key);  // The slot is free once the owner knows
+  }
+  m_controller.NotifyAll();
+  if (auto parent{move(m_parent)}) {
+    parent->on_attempt_complete(*this);
+  }
+}
+
+bool Session::may_retry(boost::beast::error_code error) const noexcept {
+  if (!m_reused || m_retried ||   // The server may have closed an idle
+      !idempotent(m_request.method())) {  // connection right before it
+    return false;                         // was reused
+  }
+  if (streaming() && m_body_stream->delivered) {
+    return false;  // The sink has the chunks already: a rerun would repeat them
+  }
+  return error == boost::beast::http::error::end_of_stream ||
+         error == boost::asio::error::connection_reset ||
+         error == boost::asio::ssl::error::stream_truncated ||
+         error == boost::asio::error::broken_pipe ||
+         error == boost::asio::error::eof;
+}
+
+optional<Session::clock_t::duration> Session::retry_delay(
+    boost::beast::error_code error) const {
+  if (m_attempt >= m_retry_policy.max_attempts ||
+      !idempotent(m_request.method())) {
+    return nullopt;
+  }
+  if (error) {
+    if (!transient(error) || (streaming() && m_body_stream->delivered)) {
+      return nullopt;
+    }
+  } else {
+    const auto status{m_response.result()};
+    if (!m_retry_policy.retry_unavailable || streaming() ||
+        (status != boost::beast::http::status::bad_gateway &&
+         status != boost::beast::http::status::service_unavailable &&
+         status != boost::beast::http::status::gateway_timeout)) {
+      return nullopt;
+    }
+  }
+  chrono::duration<double, milli> backoff{m_retry_policy.initial_backoff};
+  for (size_t attempt = 1; attempt < m_attempt; ++attempt) {
+    backoff *= m_retry_policy.backoff_multiplier;
+  }
+  backoff = min(backoff, chrono::duration<double, milli>{
+                             m_retry_policy.max_backoff});
+  thread_local minstd_rand random_engine{random_device{}()};
+  uniform_real_distribution<double> jitter{backoff.count() / 2,
+                                           backoff.count()};
+  const auto delay{chrono::duration_cast<clock_t::duration>(
+      chrono::duration<double, milli>{jitter(random_engine)})};
+  if (deadline(chrono::milliseconds::zero()) <= clock_t::now() + delay) {
+    return nullopt;  // The total would run out while waiting
+  }
+  return delay;
+}
+
+bool Session::hedged() const noexcept {
+  return m_hedging.delay.count() != 0 && !m_parent && !streaming() &&
+         idempotent(m_request.method());
+}
+
+void Session::on_attempt_complete(Session& attempt) {
+  {
+    lock_guard lock(m_hedge->mtx);
+    --m_hedge->running;
+    if (m_hedge->settled || (attempt.m_error && m_hedge->running != 0)) {
+      return;  // Lost, or failed while another attempt may still succeed
+    }
+    m_hedge->settled = true;
+    m_hedge->timer.cancel();
+  }
+  m_response = move(attempt.m_response);  // Done: nobody else touches it
+  complete(attempt.m_error);
+}
+
+void Session::release_connection(boost::beast::error_code error) {
+  auto connection{move(m_connection)};
+  const bool keep_alive{!error && m_request.keep_alive() &&
+                        m_response.keep_alive() &&
+                        connection->buffer.size() == 0};
+  if (m_connections && keep_alive) {
+    m_connections->Release(m_host_key, move(connection));
+  } else if (m_connections) {
+    m_connections->Discard(m_host_key, move(connection));
+  } else {
+    boost::beast::error_code shutdown_error;
+    connection->stream.socket().shutdown(
+        boost::asio::ip::tcp::socket::shutdown_both, shutdown_error);
+  }
+}
+
+void Session::reset_response() {
+  m_response = {};
+  if (streaming()) {
+    auto& parser{m_body_stream->parser.emplace()};
+    parser.body_limit(
+        numeric_limits<uint64_t>::max());  // Nothing is accumulated
+    parser.skip(m_request.method() == method::head);
+  }
+}
+
+Session::clock_t::time_point Session::deadline(
+    chrono::milliseconds timeout) const noexcept {
+  auto result{timeout.count() != 0 ? clock_t::now() + timeout
+                                   : clock_t::time_point::max()};
+  if (m_timeouts.total.count() != 0) {
+    result = min(result, m_created + m_timeouts.total);
+  }
+  return result;
+}
+
+void Session::set_deadline(Connection::stream_type& stream,
+                           chrono::milliseconds timeout) const {
+  if (const auto expiry{deadline(timeout)};
+      expiry == clock_t::time_point::max()) {
+    stream.expires_never();
+  } else {
+    stream.expires_at(expiry);
+  }
+}
+
+bool Session::finish_resolving() noexcept {
+  return m_resolving.exchange(false, memory_order_acq_rel);
+}
+
+void Session::on_backoff(session_holder session,
+                         boost::beast::error_code error) {
+  if (error) {
+    session->complete(error);  // The io_context is being stopped
+  } else {
+    RunAsync(move(session));
+  }
+}
+
+void Session::start_hedged(session_holder session) {
+  auto& hedge{session->m_hedge};
+  if (!hedge) {
+    hedge = make_unique<Hedge>(session->m_io);
+  }
+  hedge->running = 1;
+  hedge->timer.expires_after(session->m_hedging.delay);  // Before an attempt
+  hedge->timer.async_wait(BindAllocator(                 // can cancel it
+      session->m_allocator,
+      [session](boost::beast::error_code error) mutable {
+        on_hedge_timer(move(session), error);
+      }));
+  launch_attempt(session);
+}
+
+void Session::on_hedge_timer(session_holder session,
+                             boost::beast::error_code error) {
+  if (error) {
+    return;  // Settled in time
+  }
+  {
+    auto& hedge{*session->m_hedge};
+    lock_guard lock(hedge.mtx);
+    if (hedge.settled) {
+      return;
+    }
+    ++hedge.running;
+  }
+  launch_attempt(session);
+}
+
+void Session::launch_attempt(const session_holder& session) {
+  auto attempt{make_shared<Session>(session->m_request, session->m_io,
+                                    session->m_connections,
+                                    session->m_resolver_cache,
+                                    session->m_allocator)};
+  attempt->m_timeouts = session->m_timeouts;
+  attempt->m_retry_policy = session->m_retry_policy;
+  attempt->m_created = session->m_created;  // Shares the total
+  attempt->m_parent = session;
+  RunAsync(move(attempt));
+}
+
+void Session::on_acquire(session_holder session,
+                         connection_holder connection,
+                         bool reused) {
+  session->m_connection = move(connection);
+  session->m_reused = reused;
+  if (session->deadline(chrono::milliseconds::zero()) <= clock_t::now()) {
+    end_session(move(session), boost::beast::error::timeout,
+                0);  // Spent the total waiting for a connection
+  } else if (reused) {
+    write(move(session));
+  } else {
+    resolve(move(session));
+  }
+}
+
+void Session::resolve(session_holder session) {
+  session->m_resolving.store(true, memory_order_release);
+  if (const auto expiry{session->deadline(session->m_timeouts.resolve)};
+      expiry != clock_t::time_point::max()) {
+    auto& timer{session->m_resolve_timer};
+    timer.expires_at(expiry);
+    timer.async_wait(BindAllocator(
+        session->m_allocator,
+        [weak_session = weak_ptr<Session>{session}](
+            boost::beast::error_code error) mutable {
+          on_resolve_timeout(move(weak_session), error);
+        }));
+  }
   auto& request{session->m_request};
+  const string service{session->service().name};
+  if (auto resolver_cache{session->m_resolver_cache}) {
+    resolver_cache->AsyncResolve(
+        static_cast<string>(request[boost::beast::http::field::host]),
+        service,
+        [session](boost::beast::error_code error,
+                  ResolverCache::results_type results) mutable {
+          on_resolve(move(session), error, move(results));
+        });
+    return;
+  }
   boost::asio::ip::tcp::resolver::query query(
       static_cast<string>(
           request[boost::beast::http::field::host]),  // boost::string_view
                                                       // isn't null-terminated!
-      static_cast<string>(request[boost::beast::http::field::protocol]));
-  session->m_resolver.async_resolve(
-      move(query), bind(&Session::on_resolve, move(session), placeholders::_1,
-                        placeholders::_2));
+      service);
+  auto& resolver{session->m_resolver};
+  resolver.async_resolve(move(query),
+                         make_handler(move(session), &Session::on_resolve));
 }
 
-void Session::throw_if_failed() const {
-  if (m_error) {
-    throw runtime_error("HTTP session failed");
+void Session::on_resolve_timeout(weak_ptr<Session> weak_session,
+                                 boost::beast::error_code error) {
+  auto session{weak_session.lock()};
+  if (error || !session || !session->finish_resolving()) {
+    return;  // Cancelled, destroyed or resolved in time
+  }
+  if (!session->m_resolver_cache) {  // A cached lookup is shared with other
+    session->m_resolver.cancel();    // sessions and runs to its end
+  }
+  // Not retried: the lookup is still running and would race with a new one
+  session->release_connection(boost::beast::error::timeout);
+  session->complete(boost::beast::error::timeout);
+}
+
+void Session::handshake(session_holder session) {
+  auto& connection{*session->m_connection};
+  if (!session->m_connections) {
+    end_session(move(session), boost::asio::error::operation_not_supported,
+                0);
+    return;
+  }
+  if (auto error{session->m_connections->StartTls(
+          session->m_host_key,
+          static_cast<string>(
+              session->m_request[boost::beast::http::field::host]),
+          connection)}) {
+    end_session(move(session), error, 0);
+    return;
   }
+  session->set_deadline(connection.stream, session->m_timeouts.connect);
+  connection.tls->async_handshake(
+      boost::asio::ssl::stream_base::client,
+      make_handler(move(session), &Session::on_handshake));
+}
+
+void Session::on_handshake(session_holder session,
+                           boost::beast::error_code error) {
+  if (error) {
+    end_session(move(session), error, 0);
+  } else {
+    write(move(session));
+  }
+}
+
+void Session::write(session_holder session) {
+  auto& connection{*session->m_connection};
+  const auto& request{session->m_request};
+  session->set_deadline(connection.stream, session->m_timeouts.write);
+  connection.VisitStream([&](auto& stream) {
+    boost::beast::http::async_write(
+        stream, request,
+        make_handler(move(session),
+                     &Session::on_write));  // The references are taken
+                                            // first: the order of evaluation
+                                            // of arguments is unspecified
+  });
 }
 
 void Session::on_resolve(session_holder session,
                          boost::beast::error_code error,
                          boost::asio::ip::tcp::resolver::results_type results) {
+  if (!session->finish_resolving()) {
+    return;  // Timed out already
+  }
+  session->m_resolve_timer.cancel();
   if (error) {
     end_session(move(session), error, 0);
   } else {
-    auto& tcp_stream{session->m_tcp_stream};
-
-    tcp_stream.expires_after(TIME_OF_CONNECTION_ATTEMPTS);
+    auto& tcp_stream{session->m_connection->stream};
+    session->set_deadline(tcp_stream, session->m_timeouts.connect);
 
-    session->m_timer.expires_from_now(
-        TIME_OF_CONNECTION_ATTEMPTS);  //    
-                                       // 
-    session->m_timer.async_wait(
-        bind(&Session::end_session, session, placeholders::_1, 0));
-
-    tcp_stream.async_connect(results, bind(&Session::on_connect, move(session),
-                                           placeholders::_1, placeholders::_2));
+    tcp_stream.async_connect(
+        results, make_handler(move(session), &Session::on_connect));
   }
 }
 
 void Session::on_connect(
     session_holder session,
     boost::beast::error_code error,
-    boost::asio::ip::tcp::resolver::results_type::endpoint_type endpoint) {
+    [[maybe_unused]] boost::asio::ip::tcp::resolver::results_type::
+        endpoint_type endpoint) {
   if (error) {
     end_session(move(session), error, 0);
+  } else if (session->service().secure) {
+    handshake(move(session));
   } else {
-    boost::beast::http::async_write(
-        session->m_tcp_stream, session->m_request,
-        bind(&Session::on_write, session, placeholders::_1,
-             placeholders::_2)  // session :  
-                                //   !
-    );
+    write(move(session));
   }
 }
 
 void Session::on_write(session_holder session,
                        boost::beast::error_code error,
                        size_t bytes_transferred) {
-  if (session->m_error = error; !error) {
+  if (error) {
+    end_session(move(session), error, bytes_transferred);
+  } else if (session->streaming()) {
+    read_header(move(session));
+  } else {
+    auto& connection{*session->m_connection};
+    auto& response{session->m_response};
+    session->set_deadline(connection.stream, session->m_timeouts.read);
+    connection.VisitStream([&](auto& stream) {
+      boost::beast::http::async_read(
+          stream, connection.buffer, response,
+          make_handler(move(session), &Session::end_session));
+    });
+  }
+}
+
+void Session::read_header(session_holder session) {
+  auto& connection{*session->m_connection};
+  auto& parser{*session->m_body_stream->parser};
+  session->set_deadline(connection.stream, session->m_timeouts.read);
+  connection.VisitStream([&](auto& stream) {
+    boost::beast::http::async_read_header(
+        stream, connection.buffer, parser,
+        make_handler(move(session), &Session::on_read_header));
+  });
+}
+
+void Session::on_read_header(session_holder session,
+                             boost::beast::error_code error,
+                             size_t bytes_transferred) {
+  if (error) {
+    end_session(move(session), error, bytes_transferred);
+  } else {
+    session->m_response.base() = session->m_body_stream->parser->get().base();
+    read_chunk(move(session));
+  }
+}
+
+void Session::read_chunk(session_holder session) {
+  auto& body_stream{*session->m_body_stream};
+  auto& parser{*body_stream.parser};
+  if (parser.is_done()) {
+    end_session(move(session), {}, 0);
+    return;
+  }
+  auto& body{parser.get().body()};
+  body.data = body_stream.chunk.data();
+  body.size = body_stream.chunk.size();
+
+  auto& connection{*session->m_connection};
+  session->set_deadline(connection.stream, session->m_timeouts.read);
+  connection.VisitStream([&](auto& stream) {
     boost::beast::http::async_read(
-        session->m_tcp_stream, session->m_dynamic_buffer, session->m_response,
-        bind(&Session::end_session, session, placeholders::_1,
-             placeholders::_2));
+        stream, connection.buffer, parser,
+        make_handler(move(session), &Session::on_read_chunk));
+  });
+}
+
+void Session::on_read_chunk(session_holder session,
+                            boost::beast::error_code error,
+                            size_t bytes_transferred) {
+  if (error == boost::beast::http::error::need_buffer) {
+    error = {};  // The chunk is full
+  }
+  if (error) {
+    end_session(move(session), error, bytes_transferred);
+    return;
+  }
+  auto& body_stream{*session->m_body_stream};
+  const size_t received{body_stream.chunk.size() -
+                        body_stream.parser->get().body().size};
+  bool accepted{true};
+  if (received != 0) {
+    body_stream.delivered = true;
+    try {
+      accepted =
+          body_stream.sink(string_view{body_stream.chunk.data(), received});
+    } catch (...) {
+      accepted = false;
+    }
+  }
+  if (accepted) {
+    read_chunk(move(session));
+  } else {  // The rest of the body is left unread: the connection is closed
+    end_session(move(session), boost::asio::error::operation_aborted, 0);
   }
 }
 
 void Session::end_session(session_holder session,
                           boost::beast::error_code error,
-                          size_t bytes_transferred) {
-  session->m_error = error;
+                          [[maybe_unused]] size_t bytes_transferred) {
+  if (error && session->may_retry(error)) {
+    session->m_retried = true;
+    session->reset_response();
+    session->m_connections->Discard(session->m_host_key,
+                                    move(session->m_connection));
+    RunAsync(move(session));
+    return;
+  }
+  if (const auto delay{session->retry_delay(error)}) {
+    session->release_connection(error);
+    session->reset_response();
+    ++session->m_attempt;
+    auto& timer{session->m_backoff_timer};
+    timer.expires_after(*delay);
+    timer.async_wait(make_handler(move(session), &Session::on_backoff));
+    return;
+  }
+  session->release_connection(error);
+  session->complete(error);
+}
 
-  // session->m_timer.cancel();              //TODO:   
-  // 
+Client::Client() : Client(ClientSettings{}) {}
 
-  auto& controller{session->m_controller};
-  controller.Stop();
-  controller.NotifyAll();
+Client::Shard::Shard(const ClientSettings& settings,
+                     shared_ptr<boost::asio::ssl::context> tls_context)
+    : io{1},  // Run by one thread: no locking inside the io_context
+      resolver_cache{make_shared<ResolverCache>(io, settings.resolver)},
+      connections{make_shared<ConnectionPool>(io, settings.connections,
+                                              move(tls_context))},
+      sessions{make_shared<SessionPool>(io, connections, resolver_cache,
+                                        settings.sessions)} {}
 
-  session->m_tcp_stream.socket().shutdown(
-      boost::asio::ip::tcp::socket::shutdown_both, error);
+Client::Client(ClientSettings settings)
+    : m_timeouts{settings.timeouts},
+      m_retry_policy{settings.retry},
+      m_hedging{settings.hedging},
+      m_sharding{settings.sharding},
+      m_limiter{make_shared<RequestLimiter>(settings.limits)},
+      m_workers(make_pool_settings(settings.io_threads)) {
+  auto tls_context{settings.tls_context ? move(settings.tls_context)
+                                        : MakeTlsContext()};
+  const size_t shard_count{m_workers.GetSettings().min_workers};
+  m_shards.reserve(shard_count);
+  m_work_guards.reserve(shard_count);
+  for (size_t shard_idx = 0; shard_idx < shard_count; ++shard_idx) {
+    auto& shard{
+        *m_shards.emplace_back(make_unique<Shard>(settings, tls_context))};
+    m_work_guards.push_back(boost::asio::make_work_guard(shard.io));
+  }
+  initialize_io_runners();
 }
 
-Client::Client()
-    : m_io_context{make_unique<boost::asio::io_context>()},
-      m_workers(max(BASIC_THREAD_COUNT, thread::hardware_concurrency()) *
-                THREAD_COUNT_MULTIPLIER) {
-  initialize_io_runner();
+Client::~Client() {
+  m_limiter->Close();  // Queued sessions would never start
+  for (auto& shard : m_shards) {
+    shard->sessions->Close();  // Sessions completing from now on are
+  }                            // destroyed
 }
 
 session_holder Client::SendRequest(request req) {
   return start_async_session(move(req));
 }
 
-session_holder Client::start_async_session(request&& req) {
-  auto session{make_shared<Session>(move(req), *m_io_context)};
-  Session::RunAsync(session);
-  return session;
+session_holder Client::SendRequest(request req,
+                                   Session::completion_handler_t on_complete) {
+  return start_async_session(move(req), move(on_complete));
 }
 
-void Client::initialize_io_runner() {
-  m_io_context->post([&controller = m_controller]() {  //  run()
-    controller.Wait();
+future<response> Client::SendRequestAsync(request req) {
+  auto result{make_shared<promise<response>>()};
+  auto response_future{result->get_future()};
+  start_async_session(move(req), [result](session_holder session) {
+    if (auto error{session->GetError()}) {
+      result->set_exception(
+          make_exception_ptr(boost::system::system_error(error)));
+    } else {
+      result->set_value(*session->ExtractResponse());
+    }
   });
-  m_workers.EnqueueMulti([io = m_io_context.get()]() { io->run(); },
-                         BASIC_THREAD_COUNT * THREAD_COUNT_MULTIPLIER);
+  return response_future;
+}
+
+Client::executor_type Client::GetExecutor() const noexcept {
+  return m_shards.front()->io.get_executor();
+}
+
+size_t Client::IoThreads() const noexcept {
+  return m_shards.size();
+}
+
+vector<session_holder> Client::SendBatch(vector<request> requests,
+                                         BatchSettings settings) {
+  if (requests.empty()) {
+    return {};
+  }
+  auto same_target{[&front = requests.front()](const request& req) {
+    return req[field::host] == front[field::host] &&
+           req[field::protocol] == front[field::protocol];
+  }};
+  if (!all_of(requests.begin(), requests.end(), same_target)) {
+    throw invalid_argument("Batched requests must target the same host");
+  }
+  const size_t request_count{requests.size()},
+      pipeline_count{
+          min(max(settings.max_connections, size_t{1}), request_count)};
+  vector<session_holder> sessions;
+  sessions.reserve(request_count);
+  for (size_t pipeline_idx = 0; pipeline_idx < pipeline_count;
+       ++pipeline_idx) {
+    auto& shard{select_shard(requests.front())};  // A pipeline and its
+    auto pipeline{make_shared<Pipeline>(          // sessions share a thread
+        shard.io, shard.connections, shard.resolver_cache,
+        settings.pipeline_depth)};
+    for (size_t session_idx = request_count * pipeline_idx / pipeline_count;
+         session_idx < request_count * (pipeline_idx + 1) / pipeline_count;
+         ++session_idx) {
+      auto& session{sessions.emplace_back(
+          shard.sessions->Acquire(move(requests[session_idx])))};
+      session->SetTimeouts(m_timeouts);
+      pipeline->Add(session);
+    }
+    Pipeline::Run(move(pipeline));
+  }
+  return sessions;
+}
+
+session_holder Client::SendRequest(request req,
+                                   const SessionTimeouts& timeouts,
+                                   Session::completion_handler_t on_complete) {
+  return start_async_session(move(req), move(on_complete), nullptr, &timeouts);
+}
+
+session_holder Client::StreamRequest(
+    request req,
+    body_sink_t sink,
+    Session::completion_handler_t on_complete) {
+  return start_async_session(move(req), move(on_complete), move(sink));
+}
+
+session_holder Client::start_async_session(
+    request&& req,
+    Session::completion_handler_t on_complete,
+    body_sink_t sink,
+    const SessionTimeouts* timeouts) {
+  auto& shard{select_shard(req)};
+  auto session{shard.sessions->Acquire(move(req))};
+  session->SetTimeouts(timeouts ? *timeouts : m_timeouts);
+  session->SetRetryPolicy(m_retry_policy);
+  session->SetHedging(m_hedging);
+  if (sink) {
+    session->StreamBody(move(sink));
+  }
+  if (on_complete) {
+    session->OnComplete(move(on_complete));  // Before the session can end
+  }
+  m_limiter->Submit(session);
+  return session;
+}
+
+Client::Shard& Client::select_shard(const request& req) noexcept {
+  if (m_shards.size() == 1) {
+    return *m_shards.front();
+  }
+  size_t shard_idx;
+  if (m_sharding == ShardingPolicy::ByHost) {
+    const auto host{req[field::host]};
+    shard_idx = hash<string_view>{}({host.data(), host.size()});
+  } else {
+    shard_idx = m_next_shard.fetch_add(1, memory_order_relaxed);
+  }
+  return *m_shards[shard_idx % m_shards.size()];
+}
+
+utility::concurrency::ThreadPoolSettings Client::make_pool_settings(
+    size_t io_threads) {
+  if (io_threads == 0) {
+    io_threads = max(thread::hardware_concurrency(), 1u);
+  }
+  utility::concurrency::ThreadPoolSettings settings;
+  settings.min_workers = io_threads;  // A runner per shard
+  settings.max_workers = io_threads;  // which never returns
+  settings.thread_name = "http-io";
+  return settings;
+}
+
+void Client::initialize_io_runners() {
+  for (auto& shard : m_shards) {
+    m_workers.Enqueue([io = &shard->io]() { io->run(); });
+  }
 }
 }  // namespace web::http
@@ -1,14 +1,29 @@
 #pragma once
+#include "connection_pool.h"
+#include "handler_allocator.hpp"
+#include "pipeline.h"
+#include "request_limiter.h"
+#include "resolver_cache.h"
+#include "session_pool.h"
 #include "thread_pool.hpp"
 
-#include <boost/asio.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
 #include <boost/beast.hpp>
 #include <boost/assert.hpp>
 
 #include <chrono>
+#include <functional>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -20,8 +35,15 @@ using result_code_t = unsigned int;
 using field = boost::beast::http::field;
 using method = boost::beast::http::verb;
 
-class Session;
-using session_holder = std::shared_ptr<Session>;
+// Receives the response body piece by piece; returning false aborts the
+// transfer. The chunk is valid only during the call
+using body_sink_t = std::function<bool(std::string_view chunk)>;
+
+body_sink_t MakeFileSink(
+    const std::string& path);  // Written straight to the file descriptor
+
+// TLS 1.2 or newer, peers are verified against the default CA paths
+std::shared_ptr<boost::asio::ssl::context> MakeTlsContext();
 
 enum class ResultCodeCategory {
     Informational = 1,
@@ -31,16 +53,56 @@ enum class ResultCodeCategory {
     ServerError
 };
 
-class Session {
+// A phase that runs out of time fails the session with
+// boost::beast::error::timeout. Zero disables a deadline
+struct SessionTimeouts {
+  static constexpr std::chrono::milliseconds DEFAULT_PHASE_TIMEOUT{10'000};
+
+  std::chrono::milliseconds resolve{DEFAULT_PHASE_TIMEOUT},
+      connect{DEFAULT_PHASE_TIMEOUT},  // The TLS handshake included
+      write{DEFAULT_PHASE_TIMEOUT},
+      read{DEFAULT_PHASE_TIMEOUT},  // Between chunks in streaming mode
+      total{0};  // From the creation of the session, retries included
+};
+
+// Idempotent requests that fail with a transient error (a refused, reset
+// or timed out connection, a failed lookup to be tried again) are sent
+// again after a pause. The pause grows exponentially and is randomized
+// between its half and its full length, so clients that failed together
+// don't come back together. No attempt is made past the total timeout
+struct RetryPolicy {
+  size_t max_attempts{3};  // The first one included, 1 disables retries
+  std::chrono::milliseconds initial_backoff{100}, max_backoff{2'000};
+  double backoff_multiplier{2.0};
+  bool retry_unavailable{true};  // On 502, 503 and 504 as well, except
+};                               // for streamed bodies
+
+// An idempotent request still unanswered after the delay is sent once more
+// over another connection; the first successful response wins and the
+// slower attempt is left to finish on its own. Not for streamed bodies
+struct HedgingPolicy {
+  std::chrono::milliseconds delay{0};  // Zero disables hedging
+};
+
+class Session : public std::enable_shared_from_this<Session> {
  public:
-  static constexpr std::chrono::seconds TIME_OF_CONNECTION_ATTEMPTS{10};
+  static constexpr size_t DEFAULT_CHUNK_SIZE{64 * 1024},
+      MAX_RETAINED_BODY{64 * 1024};  // Body capacity kept by recycling
 
  public:
+  using clock_t = std::chrono::steady_clock;
   using error_code = boost::beast::error_code;
+  using completion_handler_t = std::function<void(session_holder)>;
   enum class Status { Success, Fail, InProgress };
 
  public:
-  Session(request request, boost::asio::io_context& io);
+  Session(request request,
+          boost::asio::io_context& io,
+          std::shared_ptr<ConnectionPool> connections =
+              nullptr,  // Without a pool the connection is closed at the
+                        // end and HTTPS isn't available
+          std::shared_ptr<ResolverCache> resolver_cache = nullptr,
+          handler_allocator_t allocator = {});  // For asynchronous operations
 
   Status GetSessionStatus() const noexcept;  // 
   const request& GetRequest() const noexcept;
@@ -54,11 +116,89 @@ class Session {
   std::optional<result_code_t> GetResultCode() const;
   std::optional<ResultCodeCategory> GetResultCodeCategory() const;
 
-  static void RunAsync(session_holder session);
+  // Invoked once by the io thread which completes the session, or in place
+  // if it has completed already. Exceptions thrown by the handler are
+  // dropped; accessors don't block inside it
+  void OnComplete(completion_handler_t handler);
+
+  // Must precede RunAsync(). The body is passed to the sink in chunks of
+  // at most chunk_size bytes as it arrives, so memory use doesn't depend on
+  // its length; the response keeps the header only. Each chunk restarts
+  // the timeout
+  void StreamBody(body_sink_t sink, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+  void SetTimeouts(const SessionTimeouts& timeouts);  // Must precede RunAsync()
+  void SetRetryPolicy(const RetryPolicy& policy);     // Must precede RunAsync()
+  void SetHedging(const HedgingPolicy& policy);       // Must precede RunAsync()
+
+  static void RunAsync(session_holder session);  // On the io thread
 
  private:
+  friend class Pipeline;
+  friend class RequestLimiter;
+  friend class SessionPool;
+
+  struct BodyStream {
+    using parser_t = boost::beast::http::response_parser<
+        boost::beast::http::buffer_body>;
+
+    body_sink_t sink;
+    std::vector<char> chunk;
+    std::optional<parser_t> parser;  // Replaced on retry
+    bool delivered{false};  // Since then the request can't be retried
+  };
+
+  struct Hedge {  // A hedged session only collects the result of attempts
+    explicit Hedge(boost::asio::io_context& io) : timer(io) {}
+
+    std::mutex mtx;
+    boost::asio::steady_timer timer;  // Sends the second attempt
+    size_t running{0};
+    bool settled{false};
+  };
+
+  static bool idempotent(method verb) noexcept;
+  static bool transient(boost::beast::error_code error) noexcept;
+
+  template <class Handler>  // Handler(session_holder, Args...)
+  static auto make_handler(session_holder&& session, Handler handler);
+
+  ConnectionPool::Service service() const noexcept;
+  void reuse(request&& req);
+  bool clear() noexcept;  // False if the session can't be reused
+  bool streaming() const noexcept;
+
   void throw_if_failed() const;
+  void complete(boost::beast::error_code error);
+  bool may_retry(boost::beast::error_code error) const noexcept;
+  std::optional<clock_t::duration> retry_delay(
+      boost::beast::error_code error) const;  // Empty if not to be retried
+  bool hedged() const noexcept;
+  void on_attempt_complete(Session& attempt);
+  void release_connection(boost::beast::error_code error);
+  void reset_response();
+  clock_t::time_point deadline(
+      std::chrono::milliseconds timeout) const noexcept;  // The total included
+  void set_deadline(Connection::stream_type& stream,
+                    std::chrono::milliseconds timeout) const;
+  bool finish_resolving() noexcept;  // Only the first caller gets true
 
+  static void start(session_holder session);
+  static void on_backoff(session_holder session,
+                         boost::beast::error_code error);
+  static void start_hedged(session_holder session);
+  static void on_hedge_timer(session_holder session,
+                             boost::beast::error_code error);
+  static void launch_attempt(const session_holder& session);
+  static void on_acquire(session_holder session,
+                         connection_holder connection,
+                         bool reused);
+  static void resolve(session_holder session);
+  static void on_resolve_timeout(std::weak_ptr<Session> weak_session,
+                                 boost::beast::error_code error);
+  static void handshake(session_holder session);
+  static void on_handshake(session_holder session,
+                           boost::beast::error_code error);
+  static void write(session_holder session);
   static void on_resolve(session_holder session,
                          boost::beast::error_code error,
                          boost::asio::ip::tcp::resolver::results_type results);
@@ -69,6 +209,14 @@ class Session {
   static void on_write(session_holder session,
                        boost::beast::error_code error,
                        size_t bytes_transferred);
+  static void read_header(session_holder session);
+  static void on_read_header(session_holder session,
+                             boost::beast::error_code error,
+                             size_t bytes_transferred);
+  static void read_chunk(session_holder session);
+  static void on_read_chunk(session_holder session,
+                            boost::beast::error_code error,
+                            size_t bytes_transferred);
   static void end_session(session_holder session,
                           boost::beast::error_code,
                           size_t bytes_transferred);
@@ -76,32 +224,127 @@ class Session {
  private:
   request m_request;
   response m_response;
+  boost::asio::io_context& m_io;
   boost::asio::ip::tcp::resolver m_resolver;
-  boost::asio::basic_waitable_timer<std::chrono::steady_clock> m_timer;
-  boost::beast::tcp_stream m_tcp_stream;
-  boost::beast::flat_buffer m_dynamic_buffer;
+  boost::asio::steady_timer m_resolve_timer;  // Holds no session_holder
+  std::atomic<bool> m_resolving{false};
+  SessionTimeouts m_timeouts;
+  RetryPolicy m_retry_policy;
+  HedgingPolicy m_hedging;
+  size_t m_attempt{1};
+  boost::asio::steady_timer m_backoff_timer;
+  clock_t::time_point m_created;
+  std::shared_ptr<ResolverCache> m_resolver_cache;
+  std::shared_ptr<ConnectionPool> m_connections;
+  std::string m_host_key;
+  connection_holder m_connection;
+  bool m_reused{false}, m_retried{false};
   error_code m_error;
+  std::unique_ptr<BodyStream>
+      m_body_stream;  // Streaming mode only, kept by recycling
+  handler_allocator_t m_allocator;
+  std::shared_ptr<RequestLimiter> m_limiter;  // While in flight
+  session_holder m_parent;                    // Of a hedged attempt
+  std::unique_ptr<Hedge> m_hedge;             // Kept by recycling
 
   mutable utility::concurrency::ThreadController
       m_controller;  // 
 };
 
+enum class ShardingPolicy {
+  RoundRobin,  // Spreads the load of a single host over all threads
+  ByHost       // Keeps each host on one thread: fewer connections and lookups
+};
+
+struct ClientSettings {
+  size_t io_threads{0};  // 0 - std::thread::hardware_concurrency()
+  ShardingPolicy sharding{ShardingPolicy::RoundRobin};
+  ConnectionPoolSettings connections;  // Per thread, as well as the
+  ResolverCacheSettings resolver;      // resolver and the session caches
+  SessionPoolSettings sessions;
+  RequestLimiterSettings limits;  // Batches are limited by BatchSettings
+  RetryPolicy retry;
+  HedgingPolicy hedging;
+  SessionTimeouts timeouts;  // For requests sent without their own
+  std::shared_ptr<boost::asio::ssl::context>
+      tls_context;  // Shared by HTTPS connections, MakeTlsContext() if null
+};
+
+/*********************************************************************
+Every io thread runs its own io_context with its own connection pool,
+resolver cache and session pool (a shard). A request is assigned to a
+shard once and is served by its thread only, so connections need no
+strands, and threads don't contend for the queue of a shared io_context
+*********************************************************************/
 class Client {
- private:
-  static constexpr unsigned int BASIC_THREAD_COUNT{3},
-      THREAD_COUNT_MULTIPLIER{1};
+ public:
+  using executor_type = boost::asio::io_context::executor_type;
 
  public:
   Client();
+  explicit Client(ClientSettings settings);
+  ~Client();
   session_holder SendRequest(request req);
+  session_holder SendRequest(request req,
+                             Session::completion_handler_t on_complete);
+  session_holder SendRequest(
+      request req,
+      const SessionTimeouts& timeouts,
+      Session::completion_handler_t on_complete = nullptr);
+  std::future<response> SendRequestAsync(
+      request req);  // boost::system::system_error on failure
+  session_holder StreamRequest(
+      request req,
+      body_sink_t sink,  // See Session::StreamBody()
+      Session::completion_handler_t on_complete = nullptr);
+
+  // Requests must share the host and the service. Sessions are returned in
+  // the order of requests and complete independently. Batches bypass the
+  // RequestLimiter and the RetryPolicy: BatchSettings bound the requests in
+  // flight, and a pipeline resends its idempotent requests itself
+  std::vector<session_holder> SendBatch(std::vector<request> requests,
+                                        BatchSettings settings = {});
+
+  executor_type GetExecutor() const noexcept;  // co_await coro::Schedule(
+                                               // client.GetExecutor())
+  size_t IoThreads() const noexcept;
+
+ private:
+  struct Shard {
+    Shard(const ClientSettings& settings,
+          std::shared_ptr<boost::asio::ssl::context> tls_context);
+
+    boost::asio::io_context io;
+    std::shared_ptr<ResolverCache> resolver_cache;
+    std::shared_ptr<ConnectionPool>
+        connections;  // Idle sockets are closed after the runners exit
+    std::shared_ptr<SessionPool> sessions;
+  };
+
+  using work_guard_t =
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
 
  private:
-  session_holder start_async_session(request&& req);
-  void initialize_io_runner();
+  session_holder start_async_session(
+      request&& req,
+      Session::completion_handler_t on_complete = nullptr,
+      body_sink_t sink = nullptr,
+      const SessionTimeouts* timeouts = nullptr);
+  Shard& select_shard(const request& req) noexcept;
+  static utility::concurrency::ThreadPoolSettings make_pool_settings(
+      size_t io_threads);
+  void initialize_io_runners();
 
  private:
-  std::unique_ptr<boost::asio::io_context> m_io_context;
+  const SessionTimeouts m_timeouts;
+  const RetryPolicy m_retry_policy;
+  const HedgingPolicy m_hedging;
+  const ShardingPolicy m_sharding;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  std::atomic<size_t> m_next_shard{0};  // For ShardingPolicy::RoundRobin
+  std::shared_ptr<RequestLimiter> m_limiter;
   utility::concurrency::ThreadPool m_workers;
-  utility::concurrency::ThreadController m_controller;
+  std::vector<work_guard_t>
+      m_work_guards;  // Released first: then the runners exit once idle
 };
 }  // namespace web::http
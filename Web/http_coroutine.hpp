@@ -0,0 +1,31 @@
+#pragma once
+#include "http_client.h"
+
+#include <coroutine>
+#include <utility>
+
+/*C++20 or newer needed*/
+namespace web::http {
+class SessionAwaiter {  // auto session{co_await client.SendRequest(req)};
+ public:               // resumes on the io thread which completes it
+  explicit SessionAwaiter(session_holder session) noexcept
+      : m_session{std::move(session)} {}
+
+  bool await_ready() const noexcept {
+    return m_session->GetSessionStatus() != Session::Status::InProgress;
+  }
+
+  void await_suspend(std::coroutine_handle<> coroutine) {
+    m_session->OnComplete([coroutine](session_holder) { coroutine.resume(); });
+  }
+
+  session_holder await_resume() noexcept { return std::move(m_session); }
+
+ private:
+  session_holder m_session;
+};
+
+inline SessionAwaiter operator co_await(session_holder session) noexcept {
+  return SessionAwaiter{std::move(session)};
+}
+}  // namespace web::http
@@ -0,0 +1,49 @@
+#pragma once
+#include "../Containers/mpmc_queue.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace utility::concurrency {
+/*********************************************************************
+Bounded multi-producer multi-consumer ring buffer used by ThreadPool: a
+thin adapter over container::mpmc_queue (D. Vyukov's algorithm) that
+keeps the task queue nothrow
+*********************************************************************/
+template <class Ty>
+class BoundedMpmcQueue {
+ private:
+  static_assert(std::is_nothrow_move_constructible_v<Ty> &&
+                    std::is_nothrow_move_assignable_v<Ty>,
+                "Ty must be nothrow movable");
+
+ public:
+  explicit BoundedMpmcQueue(size_t capacity)  // Rounded up to a power of two
+      : m_queue{capacity} {}
+
+  BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+  BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+  template <class Value>
+  bool TryPush(Value&& value) noexcept(
+      std::is_nothrow_constructible_v<Ty, Value&&>) {
+    return m_queue.try_emplace(std::forward<Value>(value));  // False if full
+  }
+
+  bool TryPop(Ty& value) noexcept {
+    return m_queue.try_pop(value);  // False if empty
+  }
+
+  size_t SizeApprox() const noexcept {  // Exact if nobody modifies the queue
+    return m_queue.size_approx();
+  }
+
+  bool Empty() const noexcept { return m_queue.empty(); }
+  bool Full() const noexcept { return m_queue.full(); }
+  size_t Capacity() const noexcept { return m_queue.capacity(); }
+
+ private:
+  container::mpmc_queue<Ty> m_queue;
+};
+}  // namespace utility::concurrency
@@ -0,0 +1,281 @@
+#include "pipeline.h"
+#include "http_client.h"
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace web::http {
+Pipeline::Pipeline(boost::asio::io_context& io,
+                   shared_ptr<ConnectionPool> connections,
+                   shared_ptr<ResolverCache> resolver_cache,
+                   size_t depth)
+    : m_io{io},
+      m_connections{move(connections)},
+      m_resolver_cache{move(resolver_cache)},
+      m_depth{max(depth, size_t{1})},
+      m_resolve_timer{io} {}
+
+void Pipeline::Add(session_holder session) {
+  m_pending.push_back(move(session));
+}
+
+void Pipeline::Run(shared_ptr<Pipeline> pipeline) {
+  if (pipeline->m_pending.empty()) {
+    return;
+  }
+  pipeline->m_host_key = pipeline->m_pending.front()->m_host_key;
+  acquire(move(pipeline));
+}
+
+void Pipeline::acquire(shared_ptr<Pipeline> self) {
+  auto connections{self->m_connections};
+  const auto host_key{self->m_host_key};
+  connections->Acquire(
+      host_key, [self = move(self)](connection_holder connection,
+                                    bool reused) mutable {
+        const auto executor{connection->stream.get_executor()};
+        boost::asio::dispatch(
+            executor, [self = move(self), connection = move(connection),
+                       reused]() mutable {
+              on_acquire(move(self), move(connection), reused);
+            });
+      });
+}
+
+void Pipeline::on_acquire(shared_ptr<Pipeline> self,
+                          connection_holder connection,
+                          bool reused) {
+  self->m_connection = move(connection);
+  self->expire_overdue();  // Spent the total waiting for a connection
+  if (reused || self->m_pending.empty()) {
+    pump(move(self));
+    return;
+  }
+  const auto& session{*self->m_pending.front()};
+  const auto& request{session.m_request};
+  auto resolver_cache{self->m_resolver_cache};
+  const auto executor{self->m_connection->stream.get_executor()};
+  self->m_resolving = true;
+  if (const auto expiry{session.deadline(session.m_timeouts.resolve)};
+      expiry != Session::clock_t::time_point::max()) {
+    self->m_resolve_timer.expires_at(expiry);
+    self->m_resolve_timer.async_wait(boost::asio::bind_executor(
+        executor, [self](error_code error) mutable {
+          on_resolve_timeout(move(self), error);
+        }));
+  }
+  resolver_cache->AsyncResolve(
+      static_cast<string>(request[boost::beast::http::field::host]),
+      string{session.service().name},
+      boost::asio::bind_executor(
+          executor, [self](error_code error,
+                         ResolverCache::results_type results) mutable {
+            on_resolve(move(self), error, move(results));
+          }));
+}
+
+void Pipeline::on_resolve(shared_ptr<Pipeline> self,
+                          error_code error,
+                          ResolverCache::results_type results) {
+  if (!exchange(self->m_resolving, false)) {
+    return;  // Timed out already
+  }
+  self->m_resolve_timer.cancel();
+  if (error) {
+    self->fail_all(error);
+    return;
+  }
+  auto& stream{self->m_connection->stream};
+  const auto& session{*self->m_pending.front()};
+  session.set_deadline(stream, session.m_timeouts.connect);
+  stream.async_connect(
+      results, [self](error_code error,
+                      const boost::asio::ip::tcp::endpoint&) mutable {
+        on_connect(move(self), error);
+      });
+}
+
+void Pipeline::on_resolve_timeout(shared_ptr<Pipeline> self,
+                                  error_code error) {
+  if (error || !exchange(self->m_resolving, false)) {
+    return;  // Cancelled or resolved in time
+  }
+  // The cached lookup goes on for the other callers
+  self->fail_all(boost::beast::error::timeout);
+}
+
+void Pipeline::on_connect(shared_ptr<Pipeline> self, error_code error) {
+  if (error) {
+    self->fail_all(error);
+  } else if (self->m_pending.front()->service().secure) {
+    handshake(move(self));
+  } else {
+    pump(move(self));
+  }
+}
+
+void Pipeline::handshake(shared_ptr<Pipeline> self) {
+  auto& connection{*self->m_connection};
+  const auto& session{*self->m_pending.front()};
+  const auto& request{session.m_request};
+  if (auto error{self->m_connections->StartTls(
+          self->m_host_key,
+          static_cast<string>(request[boost::beast::http::field::host]),
+          connection)}) {
+    self->fail_all(error);
+    return;
+  }
+  session.set_deadline(connection.stream, session.m_timeouts.connect);
+  connection.tls->async_handshake(
+      boost::asio::ssl::stream_base::client,
+      [self](error_code error) mutable { on_handshake(move(self), error); });
+}
+
+void Pipeline::on_handshake(shared_ptr<Pipeline> self, error_code error) {
+  if (error) {
+    self->fail_all(error);
+  } else {
+    pump(move(self));
+  }
+}
+
+void Pipeline::pump(shared_ptr<Pipeline> self) {
+  if (self->m_broken) {
+    if (!self->m_writing && !self->m_reading) {
+      self->recover(move(self));
+    }
+    return;
+  }
+  self->expire_overdue();
+  if (!self->m_writing && !self->m_pending.empty() &&
+      self->m_in_flight.size() < self->m_depth) {
+    write_next(self);
+  }
+  if (!self->m_reading && !self->m_in_flight.empty()) {
+    read_next(self);
+  }
+  if (!self->m_writing && !self->m_reading) {  // Nothing left
+    self->finish();
+  }
+}
+
+void Pipeline::write_next(shared_ptr<Pipeline> self) {
+  auto session{self->m_pending.front()};
+  self->m_pending.pop_front();
+  self->m_in_flight.push_back(session);
+  self->m_writing = true;
+
+  auto& connection{*self->m_connection};
+  session->set_deadline(connection.stream, session->m_timeouts.write);
+  connection.VisitStream([&](auto& stream) {
+    boost::beast::http::async_write(
+        stream, session->m_request,
+        BindAllocator(session->m_allocator,
+                      // The response might be read before the write ends
+                      [self, session](error_code error, size_t) mutable {
+                        self->m_writing = false;
+                        if (error) {
+                          self->break_connection(error);
+                        }
+                        pump(move(self));
+                      }));
+  });
+}
+
+void Pipeline::read_next(shared_ptr<Pipeline> self) {
+  auto session{self->m_in_flight.front()};
+  self->m_reading = true;
+
+  auto& connection{*self->m_connection};
+  session->set_deadline(connection.stream, session->m_timeouts.read);
+  connection.VisitStream([&](auto& stream) {
+    boost::beast::http::async_read(
+        stream, connection.buffer, session->m_response,
+        BindAllocator(
+            session->m_allocator,
+            [self, session](error_code error, size_t) mutable {
+              self->m_reading = false;
+              if (error) {
+                self->break_connection(error);
+              } else {
+                self->m_in_flight.pop_front();
+                self->m_attempts = 0;
+                const bool keep_alive{session->m_response.keep_alive()};
+                session->complete(error);
+                if (!keep_alive) {  // The rest is answered by nobody
+                  self->break_connection(error);
+                }
+              }
+              pump(move(self));
+            }));
+  });
+}
+
+void Pipeline::break_connection(error_code error) {
+  if (!m_broken) {
+    m_broken = true;
+    m_break_error = error;
+    m_connection->stream.close();
+  }
+}
+
+void Pipeline::recover(shared_ptr<Pipeline> self) {
+  m_connections->Discard(m_host_key, move(m_connection));
+  m_broken = false;
+  const auto error{m_break_error ? m_break_error
+                                 : make_error_code(
+                                       boost::asio::error::connection_aborted)};
+  for (auto it = m_in_flight.rbegin(); it != m_in_flight.rend(); ++it) {
+    auto& session{*it};
+    if (Session::idempotent(session->m_request.method())) {
+      session->m_response = {};
+      m_pending.push_front(move(session));
+    } else {
+      session->complete(error);  // Might have been processed
+    }
+  }
+  m_in_flight.clear();
+  if (m_pending.empty()) {
+    return;
+  }
+  if (++m_attempts > MAX_ATTEMPTS_WITHOUT_PROGRESS) {
+    fail_all(error);
+  } else {
+    acquire(move(self));
+  }
+}
+
+void Pipeline::finish() {
+  if (m_connection && m_connection->buffer.size() == 0) {
+    m_connections->Release(m_host_key, move(m_connection));
+  } else if (m_connection) {
+    m_connections->Discard(m_host_key, move(m_connection));
+  }
+}
+
+void Pipeline::fail_all(error_code error) {
+  for (auto* sessions : {&m_in_flight, &m_pending}) {
+    for (auto& session : *sessions) {
+      session->complete(error);
+    }
+    sessions->clear();
+  }
+  if (m_connection) {
+    m_connections->Discard(m_host_key, move(m_connection));
+  }
+}
+
+void Pipeline::expire_overdue() {  // The front was created first
+  const auto now{Session::clock_t::now()};
+  while (!m_pending.empty() &&
+         m_pending.front()->deadline(chrono::milliseconds::zero()) <= now) {
+    m_pending.front()->complete(boost::beast::error::timeout);
+    m_pending.pop_front();
+  }
+}
+}  // namespace web::http
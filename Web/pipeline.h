@@ -0,0 +1,89 @@
+#pragma once
+#include "connection_pool.h"
+#include "resolver_cache.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace web::http {
+class Session;
+using session_holder = std::shared_ptr<Session>;
+
+struct BatchSettings {
+  size_t max_connections{4},  // Requests are split into contiguous chunks
+      pipeline_depth{16};     // Unanswered requests per connection
+};
+
+/*********************************************************************
+HTTP/1.1 pipelining over one pooled connection: requests are written
+back-to-back while responses are read in the same order. If the server
+closes the connection (Connection: close, a reset, a timeout), the
+requests left without a response are sent again over a new connection -
+except non-idempotent ones which might have been processed already; they
+fail. The lookup is bounded by the resolve timeout of the first request,
+and a request past its total timeout fails instead of being written.
+All handlers run on the thread of the connection's io_context, so the
+writer and the reader share the state without locks
+*********************************************************************/
+class Pipeline : public std::enable_shared_from_this<Pipeline> {
+ private:
+  static constexpr size_t MAX_ATTEMPTS_WITHOUT_PROGRESS{3};
+
+ public:
+  using error_code = boost::beast::error_code;
+
+ public:
+  Pipeline(boost::asio::io_context& io,
+           std::shared_ptr<ConnectionPool> connections,
+           std::shared_ptr<ResolverCache> resolver_cache,
+           size_t depth);
+
+  void Add(session_holder session);  // Sessions must target the same host
+
+  static void Run(std::shared_ptr<Pipeline> pipeline);
+
+ private:
+  static void acquire(std::shared_ptr<Pipeline> self);
+  static void on_acquire(std::shared_ptr<Pipeline> self,
+                         connection_holder connection,
+                         bool reused);
+  static void on_resolve(std::shared_ptr<Pipeline> self,
+                         error_code error,
+                         ResolverCache::results_type results);
+  static void on_resolve_timeout(std::shared_ptr<Pipeline> self,
+                                 error_code error);
+  static void on_connect(std::shared_ptr<Pipeline> self, error_code error);
+  static void handshake(std::shared_ptr<Pipeline> self);
+  static void on_handshake(std::shared_ptr<Pipeline> self, error_code error);
+  static void pump(std::shared_ptr<Pipeline> self);
+  static void write_next(std::shared_ptr<Pipeline> self);
+  static void read_next(std::shared_ptr<Pipeline> self);
+
+  void break_connection(error_code error);  // Pending operations are aborted
+  void recover(std::shared_ptr<Pipeline> self);
+  void finish();
+  void fail_all(error_code error);
+  void expire_overdue();  // Fails the pending sessions past their total
+
+ private:
+  boost::asio::io_context& m_io;
+  std::shared_ptr<ConnectionPool> m_connections;
+  std::shared_ptr<ResolverCache> m_resolver_cache;
+  const size_t m_depth;
+  std::string m_host_key;
+  std::deque<session_holder> m_pending,  // Not written yet
+      m_in_flight;                       // Written or being written
+  connection_holder m_connection;
+  boost::asio::steady_timer m_resolve_timer;
+  bool m_writing{false}, m_reading{false}, m_broken{false},
+      m_resolving{false};
+  error_code m_break_error;
+  size_t m_attempts{0};  // Connections in a row that produced no response
+};
+}  // namespace web::http
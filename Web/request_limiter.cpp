@@ -0,0 +1,138 @@
+#include "request_limiter.h"
+#include "http_client.h"
+
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace web::http {
+RequestLimiter::RequestLimiter(RequestLimiterSettings settings)
+    : m_settings{settings} {}
+
+void RequestLimiter::Submit(session_holder session) {
+  bool admitted{false};
+  {
+    lock_guard lock(m_mtx);
+    if (!m_closed) {
+      auto& entry{*m_hosts.try_emplace(session->m_host_key).first};
+      auto& host{entry.second};
+      if (!host.waiters.empty() || !m_ready.empty() ||
+          !below_host_limit(host) || !below_limit()) {
+        const auto ticket{m_next_ticket++};
+        host.waiters.push_back({ticket, move(session)});
+        ++m_queued;
+        if (host.waiters.size() == 1 && below_host_limit(host)) {
+          m_ready.emplace(ticket, &entry);  // Waits for a global slot
+        }
+        return;
+      }
+      admit(host);
+      admitted = true;
+    }
+  }
+  if (admitted) {
+    start(move(session));
+  } else {
+    abort(move(session));
+  }
+}
+
+void RequestLimiter::Close() {
+  vector<session_holder> queued;
+  {
+    lock_guard lock(m_mtx);
+    m_closed = true;
+    for (auto& [host_key, host] : m_hosts) {
+      for (auto& waiter : host.waiters) {
+        queued.push_back(move(waiter.session));
+      }
+      host.waiters.clear();
+    }
+    m_ready.clear();
+    m_queued = 0;
+  }
+  for (auto& session : queued) {
+    abort(move(session));
+  }
+}
+
+size_t RequestLimiter::InFlight() const {
+  lock_guard lock(m_mtx);
+  return m_in_flight;
+}
+
+size_t RequestLimiter::Queued() const {
+  lock_guard lock(m_mtx);
+  return m_queued;
+}
+
+void RequestLimiter::finish(const string& host_key) {
+  vector<session_holder> admitted, expired;
+  {
+    lock_guard lock(m_mtx);
+    const auto it{m_hosts.find(host_key)};
+    auto& host{it->second};
+    const bool was_at_limit{!below_host_limit(host)};
+    --host.in_flight;
+    --m_in_flight;
+    if (was_at_limit && !host.waiters.empty()) {
+      m_ready.emplace(host.waiters.front().ticket, &*it);
+    }
+    const auto now{Session::clock_t::now()};
+    while (below_limit() && !m_ready.empty()) {
+      auto* entry{m_ready.begin()->second};
+      m_ready.erase(m_ready.begin());
+      auto& ready_host{entry->second};
+      auto session{move(ready_host.waiters.front().session)};
+      ready_host.waiters.pop_front();
+      --m_queued;
+      if (session->deadline(chrono::milliseconds::zero()) <= now) {
+        expired.push_back(move(session));  // Would complete in place
+      } else {
+        admit(ready_host);
+        admitted.push_back(move(session));
+      }
+      if (!ready_host.waiters.empty() && below_host_limit(ready_host)) {
+        m_ready.emplace(ready_host.waiters.front().ticket, entry);
+      } else if (entry != &*it && ready_host.in_flight == 0 &&
+                 ready_host.waiters.empty()) {  // Its waiters expired
+        m_hosts.erase(entry->first);
+      }
+    }
+    if (host.in_flight == 0 && host.waiters.empty()) {
+      m_hosts.erase(it);
+    }
+  }
+  for (auto& session : expired) {
+    session->complete(boost::beast::error::timeout);
+  }
+  for (auto& session : admitted) {
+    start(move(session));
+  }
+}
+
+bool RequestLimiter::below_host_limit(const Host& host) const noexcept {
+  return m_settings.max_in_flight_per_host == 0 ||
+         host.in_flight < m_settings.max_in_flight_per_host;
+}
+
+bool RequestLimiter::below_limit() const noexcept {
+  return m_settings.max_in_flight == 0 ||
+         m_in_flight < m_settings.max_in_flight;
+}
+
+void RequestLimiter::admit(Host& host) noexcept {
+  ++host.in_flight;
+  ++m_in_flight;
+}
+
+void RequestLimiter::start(session_holder session) {
+  session->m_limiter = shared_from_this();  // Released by complete()
+  Session::RunAsync(move(session));
+}
+
+void RequestLimiter::abort(session_holder session) {
+  session->complete(boost::asio::error::operation_aborted);
+}
+}  // namespace web::http
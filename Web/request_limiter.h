@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace web::http {
+class Session;
+using session_holder = std::shared_ptr<Session>;
+
+struct RequestLimiterSettings {
+  size_t max_in_flight{1024},   // Across all hosts
+      max_in_flight_per_host{0};  // Zero means no limit
+};
+
+/*********************************************************************
+Admission control for sessions: a session is started once both the
+number of requests in flight and the number of those to its host are
+below the limits, otherwise it waits in a queue. The queue is served in
+the order of arrival, but a host at its own limit doesn't hold up the
+others. A session is in flight until it completes, retries and backoffs
+included
+*********************************************************************/
+class RequestLimiter : public std::enable_shared_from_this<RequestLimiter> {
+ public:
+  explicit RequestLimiter(RequestLimiterSettings settings);
+
+  RequestLimiter(const RequestLimiter&) = delete;
+  RequestLimiter& operator=(const RequestLimiter&) = delete;
+
+  void Submit(session_holder session);  // Started in place or queued
+
+  // Fails the queued sessions and the ones submitted later with
+  // boost::asio::error::operation_aborted: nothing would start them
+  // once the io_context runners exit
+  void Close();
+
+  size_t InFlight() const;
+  size_t Queued() const;
+
+ private:
+  friend class Session;
+
+  struct Waiter {
+    uint64_t ticket;  // The order of arrival
+    session_holder session;
+  };
+
+  struct Host {
+    size_t in_flight{0};
+    std::deque<Waiter> waiters;
+  };
+
+  using host_entry_t = std::pair<const std::string, Host>;
+
+ private:
+  void finish(const std::string& host_key);  // By the completing session
+
+  bool below_host_limit(const Host& host) const noexcept;
+  bool below_limit() const noexcept;
+  void admit(Host& host) noexcept;  // Caller holds the lock
+  void start(session_holder session);
+  static void abort(session_holder session);
+
+ private:
+  const RequestLimiterSettings m_settings;
+  mutable std::mutex m_mtx;
+  std::unordered_map<std::string, Host> m_hosts;  // Pointers to the entries
+                                                  // survive rehashing
+  std::map<uint64_t, host_entry_t*>
+      m_ready;  // Hosts below their limit by the ticket of the first waiter
+  size_t m_in_flight{0}, m_queued{0};
+  uint64_t m_next_ticket{0};
+  bool m_closed{false};
+};
+}  // namespace web::http
@@ -0,0 +1,111 @@
+#include "resolver_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace web::http {
+ResolverCache::ResolverCache(boost::asio::io_context& io,
+                             ResolverCacheSettings settings)
+    : m_io{io}, m_settings{settings} {}
+
+void ResolverCache::AsyncResolve(const string& host,
+                                 const string& service,
+                                 handler_t handler) {
+  string key;
+  key.reserve(host.size() + service.size() + 1);
+  key.append(host).append(1, ':').append(service);
+  results_type results;
+  bool cached{false};
+  {
+    lock_guard lock(m_mtx);
+    const auto now{clock_t::now()};
+    if (m_entries.size() >= m_settings.max_entries) {
+      shrink(now);
+    }
+    auto& entry{m_entries[key]};
+    if (!entry.waiters.empty()) {  // Coalesced with the lookup in flight
+      entry.waiters.push_back(move(handler));
+      return;
+    }
+    if (entry.expires_at <= now) {
+      entry.waiters.push_back(move(handler));
+    } else {
+      results = entry.results;
+      cached = true;
+    }
+  }
+  if (cached) {
+    handler(boost::system::error_code{}, move(results));
+    return;
+  }
+  auto resolver{make_shared<boost::asio::ip::tcp::resolver>(m_io)};
+  resolver->async_resolve(
+      host, service,
+      [self = shared_from_this(), resolver, key = move(key)](
+          boost::system::error_code error, results_type results) {
+        self->on_resolve(key, error, move(results));
+      });
+}
+
+void ResolverCache::Clear() {
+  lock_guard lock(m_mtx);
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    if (it->second.waiters.empty()) {
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+size_t ResolverCache::Size() const {
+  lock_guard lock(m_mtx);
+  return m_entries.size();
+}
+
+void ResolverCache::on_resolve(const string& key,
+                               boost::system::error_code error,
+                               results_type results) {
+  vector<handler_t> waiters;
+  {
+    lock_guard lock(m_mtx);
+    auto it{m_entries.find(key)};
+    waiters.swap(it->second.waiters);
+    if (error) {
+      m_entries.erase(it);
+    } else {
+      it->second.results = results;
+      it->second.expires_at = clock_t::now() + m_settings.ttl;
+    }
+  }
+  for (auto& waiter : waiters) {
+    waiter(error, results);
+  }
+}
+
+void ResolverCache::shrink(clock_t::time_point now) {
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    if (it->second.waiters.empty() && it->second.expires_at <= now) {
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  while (m_entries.size() >= m_settings.max_entries) {
+    auto oldest{m_entries.end()};
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+      if (it->second.waiters.empty() &&
+          (oldest == m_entries.end() ||
+           it->second.expires_at < oldest->second.expires_at)) {
+        oldest = it;
+      }
+    }
+    if (oldest == m_entries.end()) {
+      break;  // Everything is being resolved right now
+    }
+    m_entries.erase(oldest);
+  }
+}
+}  // namespace web::http
@@ -0,0 +1,67 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace web::http {
+struct ResolverCacheSettings {
+  std::chrono::seconds ttl{60};  // getaddrinfo() doesn't report record TTLs
+  size_t max_entries{1024};
+};
+
+/*********************************************************************
+Shared cache of resolved endpoints. Concurrent lookups of the same
+host:service are coalesced into one async_resolve() whose result is
+delivered to every waiter; failures are delivered but not cached.
+Must be owned by a std::shared_ptr: pending lookups keep the cache alive
+*********************************************************************/
+class ResolverCache : public std::enable_shared_from_this<ResolverCache> {
+ public:
+  using clock_t = std::chrono::steady_clock;
+  using results_type = boost::asio::ip::tcp::resolver::results_type;
+  using handler_t =
+      std::function<void(boost::system::error_code error, results_type)>;
+
+ public:
+  ResolverCache(boost::asio::io_context& io, ResolverCacheSettings settings);
+
+  ResolverCache(const ResolverCache&) = delete;
+  ResolverCache& operator=(const ResolverCache&) = delete;
+
+  // The handler is invoked in place on a cache hit, otherwise from the
+  // io_context once the lookup completes
+  void AsyncResolve(const std::string& host,
+                    const std::string& service,
+                    handler_t handler);
+
+  void Clear();  // In-flight lookups are completed as usual
+  size_t Size() const;
+
+ private:
+  struct Entry {
+    results_type results;
+    clock_t::time_point expires_at;
+    std::vector<handler_t> waiters;  // Non-empty while resolving
+  };
+
+ private:
+  void on_resolve(const std::string& key,
+                  boost::system::error_code error,
+                  results_type results);
+  void shrink(clock_t::time_point now);  // Caller holds the lock
+
+ private:
+  boost::asio::io_context& m_io;
+  const ResolverCacheSettings m_settings;
+  mutable std::mutex m_mtx;
+  std::unordered_map<std::string, Entry> m_entries;
+};
+}  // namespace web::http
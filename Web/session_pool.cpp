@@ -0,0 +1,72 @@
+#include "session_pool.h"
+#include "http_client.h"
+
+#include <utility>
+
+using namespace std;
+
+namespace web::http {
+SessionPool::SessionPool(boost::asio::io_context& io,
+                         shared_ptr<ConnectionPool> connections,
+                         shared_ptr<ResolverCache> resolver_cache,
+                         SessionPoolSettings settings)
+    : m_io{io},
+      m_connections{move(connections)},
+      m_resolver_cache{move(resolver_cache)},
+      m_settings{settings},
+      m_allocator{make_shared<utility::memory::BlockPool>()} {
+  m_idle.reserve(m_settings.max_idle);  // recycle() doesn't throw
+}
+
+SessionPool::~SessionPool() = default;
+
+session_holder SessionPool::Acquire(request req) {
+  unique_ptr<Session> session;
+  {
+    lock_guard lock(m_mtx);
+    if (!m_idle.empty()) {
+      session = move(m_idle.back());
+      m_idle.pop_back();
+    }
+  }
+  if (session) {
+    session->reuse(move(req));
+  } else {
+    session = make_unique<Session>(move(req), m_io, m_connections,
+                                   m_resolver_cache, m_allocator);
+  }
+  return session_holder(
+      session.release(),
+      [pool = shared_from_this()](Session* session) { pool->recycle(session); },
+      m_allocator);  // The control block comes from the pool as well
+}
+
+void SessionPool::Close() {
+  vector<unique_ptr<Session>> idle;
+  {
+    lock_guard lock(m_mtx);
+    m_closed = true;
+    idle.swap(m_idle);
+  }
+}
+
+size_t SessionPool::IdleSessions() const {
+  lock_guard lock(m_mtx);
+  return m_idle.size();
+}
+
+const handler_allocator_t& SessionPool::GetAllocator() const noexcept {
+  return m_allocator;
+}
+
+void SessionPool::recycle(Session* session) noexcept {
+  unique_ptr<Session> holder{session};
+  if (!holder->clear()) {
+    return;
+  }
+  lock_guard lock(m_mtx);
+  if (!m_closed && m_idle.size() < m_settings.max_idle) {
+    m_idle.push_back(move(holder));
+  }
+}  // Destroyed outside the lock
+}  // namespace web::http
@@ -0,0 +1,66 @@
+#pragma once
+#include "connection_pool.h"
+#include "handler_allocator.hpp"
+#include "resolver_cache.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/beast.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace web::http {
+class Session;
+using session_holder = std::shared_ptr<Session>;
+
+struct SessionPoolSettings {
+  size_t max_idle{256};  // Sessions kept for reuse
+};
+
+/*********************************************************************
+Recycles sessions: when the last session_holder is dropped, the session
+goes back to the pool together with its resolver, timer and buffers and
+is handed out again for the next request. Control blocks of the holders
+and the state of the asynchronous operations come from a shared
+BlockPool, so a request costs no heap allocations once the pool is warm
+(headers and bodies excepted)
+*********************************************************************/
+class SessionPool : public std::enable_shared_from_this<SessionPool> {
+ public:
+  using request = boost::beast::http::request<boost::beast::http::string_body>;
+
+ public:
+  SessionPool(boost::asio::io_context& io,
+              std::shared_ptr<ConnectionPool> connections,
+              std::shared_ptr<ResolverCache> resolver_cache,
+              SessionPoolSettings settings);
+  ~SessionPool();
+
+  SessionPool(const SessionPool&) = delete;
+  SessionPool& operator=(const SessionPool&) = delete;
+
+  session_holder Acquire(request req);  // Not started yet
+
+  // Destroys idle sessions and stops keeping the released ones: they must
+  // not outlive the io_context
+  void Close();
+
+  size_t IdleSessions() const;
+  const handler_allocator_t& GetAllocator() const noexcept;
+
+ private:
+  void recycle(Session* session) noexcept;
+
+ private:
+  boost::asio::io_context& m_io;
+  std::shared_ptr<ConnectionPool> m_connections;
+  std::shared_ptr<ResolverCache> m_resolver_cache;
+  const SessionPoolSettings m_settings;
+  const handler_allocator_t m_allocator;
+  mutable std::mutex m_mtx;
+  std::vector<std::unique_ptr<Session>> m_idle;
+  bool m_closed{false};
+};
+}  // namespace web::http
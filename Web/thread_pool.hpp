@@ -1,12 +1,24 @@
 #pragma once
+#include "cancellation.hpp"
+#include "mpmc_queue.hpp"
+#include "thread_pool_metrics.hpp"
+#include "thread_utils.h"
+
 #include <boost/lockfree/queue.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <future>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <system_error>
 #include <thread>
 #include <tuple>
 #include <type_traits>
@@ -69,6 +81,18 @@ class ITask {
  public:
   virtual ~ITask() = default;
   virtual result_t Process() noexcept = 0;
+  virtual void Cancel() noexcept {}  // Called instead of Process() if the
+                                     // task is discarded from the queue
+
+#ifdef THREAD_POOL_METRICS
+  void MarkEnqueued() noexcept { m_enqueued_at = metrics::clock_t::now(); }
+  metrics::clock_t::time_point EnqueuedAt() const noexcept {
+    return m_enqueued_at;
+  }
+
+ private:
+  metrics::clock_t::time_point m_enqueued_at;
+#endif
 
  protected:
   static result_t operation_successful() noexcept { return true; }
@@ -140,19 +164,38 @@ class PackagedTask : public DetachedTask<Function, ArgTuple> {
 
   result_t Process() noexcept override {
     try {
-      m_promise.set_value(MyBase::call_with_unpacked_args(m_func, m_args))
+      if constexpr (std::is_void_v<ret_t>) {
+        MyBase::call_with_unpacked_args(this->m_func, this->m_args);
+        m_promise.set_value();
+      } else {
+        m_promise.set_value(
+            MyBase::call_with_unpacked_args(this->m_func, this->m_args));
+      }
     } catch (const std::exception& exc) {
-      return exception_thrown(exc);
+      return forward_exception(MyBase::exception_thrown(exc));
     } catch (...) {
-      try {
-        m_promise.set_exception(
-            std::current_exception());  //  std::future_error
-      } catch (const std::future_error& exc) {
-        return exception_thrown(exc);
-      }
-      return unknown_exception_thrown();
+      return forward_exception(MyBase::unknown_exception_thrown());
+    }
+    return MyBase::operation_successful();
+  }
+
+  void Cancel() noexcept override {
+    try {
+      m_promise.set_exception(std::make_exception_ptr(TaskCancelled{}));
+    } catch (...) {  // The promise is already satisfied
     }
-    return operation_successful();
+  }
+
+ protected:
+  result_t forward_exception(
+      result_t result) noexcept {  // Must be called from a catch block only
+    try {
+      m_promise.set_exception(
+          std::current_exception());  //  std::future_error
+    } catch (const std::future_error& exc) {
+      return MyBase::exception_thrown(exc);
+    }
+    return result;
   }
 
  protected:
@@ -170,7 +213,7 @@ auto MakeTask(Function&& func, Types&&... args) {
 }
 
 template <template <class, class> class Task, class Function, class... Types>
-task_holder MakeTaskHolder(Function&& func, Types&&... args) {
+auto MakeUniqueTask(Function&& func, Types&&... args) {
   using task_t = details::async_task_t<Task, Function, Types...>;
   static_assert(std::is_base_of_v<ITask, task_t>,
                 "Task must be derived from ITask");
@@ -178,9 +221,18 @@ task_holder MakeTaskHolder(Function&& func, Types&&... args) {
       std::forward<Function>(func),
       details::argument_tuple_t<Types...>{std::forward<Types>(args)...});
 }
+
+template <template <class, class> class Task, class Function, class... Types>
+task_holder MakeTaskHolder(Function&& func, Types&&... args) {
+  return MakeUniqueTask<Task, Function, Types...>(
+      std::forward<Function>(func), std::forward<Types>(args)...);
+}
 }  // namespace async
 
 class ThreadController {
+ public:
+  using callback_t = std::function<void()>;
+
  public:
   ThreadController() = default;
   ThreadController(bool stopped_at_creation) : m_stop{stopped_at_creation} {}
@@ -196,9 +248,13 @@ class ThreadController {
 
   void Continue() noexcept { m_stop = false; }
 
+  // Blocks until the controller is stopped: returns at once if Stop() has
+  // already been called, otherwise waits for the NotifyAll() following it.
+  // A notification without Stop() no longer ends the wait (use NotifyOne()
+  // with Wait(pred) to wake a waiter for other reasons)
   void Wait() {
     std::unique_lock thread_waid_lock(m_mtx);
-    m_cv.wait(thread_waid_lock);
+    m_cv.wait(thread_waid_lock, [this] { return Stopped(); });
   }
 
   template <class Predicate>
@@ -207,9 +263,45 @@ class ThreadController {
     m_cv.wait(thread_waid_lock, pred);
   }
 
-  void NotifyOne() { m_cv.notify_one(); }
+  template <class Rep, class Period, class Predicate>
+  bool WaitFor(const std::chrono::duration<Rep, Period>& timeout,
+               Predicate pred) {  // Returns pred() on timeout
+    std::unique_lock thread_waid_lock(m_mtx);
+    return m_cv.wait_for(thread_waid_lock, timeout, pred);
+  }
+
+  void NotifyOne() {
+    {
+      std::lock_guard lock(m_mtx);  // Waiter has either blocked or will see
+    }                               // the state changed before notification
+    m_cv.notify_one();
+  }
+
+  void NotifyAll() {
+    std::vector<callback_t> callbacks;
+    {
+      std::lock_guard lock(m_mtx);  // Predicate waiters can't miss Stop()
+      if (Stopped()) {
+        callbacks.swap(m_callbacks);
+      }
+    }
+    m_cv.notify_all();
+    for (auto& callback : callbacks) {
+      callback();
+    }
+  }
 
-  void NotifyAll() { m_cv.notify_all(); }
+  // Registers a callback invoked by the NotifyAll() following Stop().
+  // Returns false (the callback is dropped) if the controller is already
+  // stopped, so the caller may continue synchronously
+  bool Subscribe(callback_t callback) {
+    std::lock_guard lock(m_mtx);
+    if (Stopped()) {
+      return false;
+    }
+    m_callbacks.push_back(std::move(callback));
+    return true;
+  }
 
   bool InProgress() const noexcept { return !Stopped(); }
 
@@ -219,34 +311,329 @@ class ThreadController {
   std::atomic<bool> m_stop{false};
   std::mutex m_mtx;
   std::condition_variable m_cv;
+  std::vector<callback_t> m_callbacks;
+};
+
+namespace details {
+class TaskQueue {  // Unbounded lock-free list or preallocated ring buffer
+ public:
+  using value_type = async::ITask*;
+
+ public:
+  TaskQueue(size_t capacity, size_t reserved_nodes)
+      : m_unbounded(capacity ? 0 : reserved_nodes) {
+    if (capacity) {
+      m_bounded = std::make_unique<BoundedMpmcQueue<value_type>>(capacity);
+    }
+  }
+
+  bool TryPush(value_type task) {
+    return m_bounded ? m_bounded->TryPush(task) : m_unbounded.push(task);
+  }
+
+  bool TryPop(value_type& task) noexcept {
+    return m_bounded ? m_bounded->TryPop(task) : m_unbounded.pop(task);
+  }
+
+  bool Empty() const noexcept {
+    return m_bounded ? m_bounded->Empty() : m_unbounded.empty();
+  }
+
+  bool Full() const noexcept { return m_bounded && m_bounded->Full(); }
+
+  bool Bounded() const noexcept { return static_cast<bool>(m_bounded); }
+
+ private:
+  boost::lockfree::queue<value_type> m_unbounded;
+  std::unique_ptr<BoundedMpmcQueue<value_type>> m_bounded;
+};
+}  // namespace details
+
+class QueueOverflow : public std::runtime_error {
+ public:
+  QueueOverflow() : std::runtime_error("ThreadPool queue is full") {}
+};
+
+enum class WorkerAffinity { None, Core, NumaNode };
+
+enum class OverflowPolicy {  // Applied by Schedule() and Enqueue() if a
+                             // bounded queue is full
+  Block,                     // Wait for a free slot
+  Reject,                    // Throw QueueOverflow
+  CallerRuns,                // Execute the task on the submitting thread
+  DropOldest                 // Discard the oldest queued task: its future
+                             // gets TaskCancelled
+};
+
+enum class ShutdownMode {
+  Drain,  // Execute everything already queued
+  Cancel  // Discard queued tasks (futures get TaskCancelled) and cancel the
+          // pool's token; running tasks are still awaited
+};
+
+struct ThreadPoolSettings {
+  size_t min_workers{1},  // Never retired; at least one worker is kept
+      max_workers{std::max(std::thread::hardware_concurrency(), 1u)};
+  std::chrono::milliseconds idle_timeout{std::chrono::seconds{30}},
+      scale_up_latency{50};  // A worker is added if the queue hasn't been
+                             // popped for so long while nobody is idle
+  WorkerAffinity affinity{WorkerAffinity::None};
+  std::string thread_name;  // Workers are named "<thread_name>-<idx>"
+  size_t queue_capacity{0};  // 0 - unbounded, otherwise rounded up to a
+                             // power of two and preallocated
+  OverflowPolicy overflow_policy{OverflowPolicy::Block};
 };
 
 class ThreadPool {
  private:
-  using lockfree_queue = boost::lockfree::queue<async::ITask*>;
+  using clock_t = std::chrono::steady_clock;
+
+  struct Worker {
+    explicit Worker(size_t worker_idx) noexcept : idx{worker_idx} {}
+
+    std::thread thread;
+    size_t idx;  // Stable index for naming and affinity
+    std::atomic<bool> finished{false};
+#ifdef THREAD_POOL_METRICS
+    metrics::WorkerMetrics metrics;
+#endif
+  };
 
  public:
-  ThreadPool(size_t worker_count) : m_tasks(worker_count) {
-    m_workers.reserve(worker_count);
-    for (size_t idx = 0; idx < worker_count; ++idx) {
-      m_workers.emplace_back(&ThreadPool::execute, this);
+  class ScheduleAwaiter {  // co_await pool.Schedule() resumes the coroutine on
+                           // one of the pool workers (C++20 only)
+   private:
+    template <class CoroutineHandle>
+    class ResumeTask : public async::ITask {
+     public:
+      ResumeTask(CoroutineHandle coroutine, bool& cancelled) noexcept
+          : m_coroutine{coroutine}, m_cancelled{cancelled} {}
+
+      result_t Process() noexcept override {
+        try {
+          m_coroutine.resume();
+        } catch (...) {
+          return unknown_exception_thrown();
+        }
+        return operation_successful();
+      }
+
+      void Cancel() noexcept override {  // The frame mustn't leak: resume
+        m_cancelled = true;              // it to throw TaskCancelled
+        try {
+          m_coroutine.resume();
+        } catch (...) {
+        }
+      }
+
+     private:
+      CoroutineHandle m_coroutine;
+      bool& m_cancelled;
+    };
+
+   public:
+    explicit ScheduleAwaiter(ThreadPool& pool) noexcept : m_pool{pool} {}
+
+    bool await_ready() const noexcept { return false; }
+
+    template <class CoroutineHandle>
+    void await_suspend(CoroutineHandle handle) {
+      m_pool.push(
+          std::make_unique<ResumeTask<CoroutineHandle>>(handle, m_cancelled));
+    }
+
+    void await_resume() const {
+      if (m_cancelled) {
+        throw TaskCancelled{};
+      }
+    }
+
+   private:
+    ThreadPool& m_pool;
+    bool m_cancelled{false};
+  };
+
+ public:
+  ThreadPool(size_t worker_count) : ThreadPool(fixed_size(worker_count)) {}
+
+  explicit ThreadPool(ThreadPoolSettings settings)
+      : m_settings{normalize(std::move(settings))},
+        m_tasks(m_settings.queue_capacity, m_settings.max_workers),
+        m_last_dequeue{clock_t::now().time_since_epoch().count()} {
+    try {
+      for (size_t idx = 0; idx < m_settings.min_workers; ++idx) {
+        reserve_worker();
+        start_worker();
+      }
+      if (scalable()) {
+        m_supervisor = std::thread(&ThreadPool::supervise, this);
+      }
+    } catch (...) {
+      stop();
+      throw;
     }
   }
+
   ~ThreadPool() {
-    m_controller.Stop();
-    m_controller.NotifyAll();
-    for (auto& worker : m_workers) {
-      worker.join();
-    }
+    shutdown(ShutdownMode::Drain);
+    discard_queued();  // Late submissions racing with Shutdown()
   }
 
+  /*********************************************************************
+  Stops accepting tasks (Schedule() and Enqueue() throw, Try* calls
+  return nothing), handles the queue according to the mode and joins the
+  workers. Tasks submitted by running tasks are rejected as well. Can't
+  be called from a worker; repeated calls return immediately
+  *********************************************************************/
+  void Shutdown(ShutdownMode mode = ShutdownMode::Drain) {
+    throw_if_worker_thread("ThreadPool can't be shut down by its own worker");
+    shutdown(mode);
+  }
+
+  void WaitIdle() {  // Until the queue is empty and no task is running
+    throw_if_worker_thread("ThreadPool can't be awaited by its own worker");
+    m_idle_waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_idle_controller.Wait(
+        [this] { return m_pending.load(std::memory_order_relaxed) == 0; });
+    m_idle_waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Callables accepting a CancellationToken as the first parameter get
+  // this one, cancelled by Shutdown(ShutdownMode::Cancel)
+  CancellationToken GetCancellationToken() const noexcept {
+    return m_cancellation.GetToken();
+  }
+
+  ScheduleAwaiter Schedule() noexcept { return ScheduleAwaiter{*this}; }
+
   template <class Function, class... Types>
   auto Schedule(Function&& func, Types&&... args) {
+    if constexpr (details::takes_cancellation_token_v<Function, Types...>) {
+      return Schedule(std::forward<Function>(func), GetCancellationToken(),
+                      std::forward<Types>(args)...);
+    } else {
+      return schedule(std::forward<Function>(func),
+                      std::forward<Types>(args)...);
+    }
+  }
+
+  template <class Function, class... Types>
+  auto TrySchedule(Function&& func, Types&&... args) {  // Never blocks
+    if constexpr (details::takes_cancellation_token_v<Function, Types...>) {
+      return TrySchedule(std::forward<Function>(func), GetCancellationToken(),
+                         std::forward<Types>(args)...);
+    } else {
+      return try_schedule(std::forward<Function>(func),
+                          std::forward<Types>(args)...);
+    }
+  }
+
+  template <class Function, class... Types>
+  void Enqueue(Function&& func, Types&&... args) {
+    if constexpr (details::takes_cancellation_token_v<Function, Types...>) {
+      Enqueue(std::forward<Function>(func), GetCancellationToken(),
+              std::forward<Types>(args)...);
+    } else {
+      static_assert(std::is_invocable_v<Function, Types...>,
+                    "Impossible to invoke a callable with passed arguments");
+      push(async::MakeTaskHolder<async::DetachedTask, Function, Types...>(
+          std::forward<Function>(func), std::forward<Types>(args)...));
+    }
+  }
+
+  template <class Function, class... Types>
+  bool TryEnqueue(Function&& func, Types&&... args) {  // Never blocks
+    if constexpr (details::takes_cancellation_token_v<Function, Types...>) {
+      return TryEnqueue(std::forward<Function>(func), GetCancellationToken(),
+                        std::forward<Types>(args)...);
+    } else {
+      static_assert(std::is_invocable_v<Function, Types...>,
+                    "Impossible to invoke a callable with passed arguments");
+      auto task_guard{
+          async::MakeTaskHolder<async::DetachedTask, Function, Types...>(
+              std::forward<Function>(func), std::forward<Types>(args)...)};
+      if (!try_push(task_guard)) {
+        task_rejected();
+        return false;
+      }
+      return true;
+    }
+  }
+
+  template <class Function, class... Types>
+  void EnqueueMulti(const Function& func,
+                    size_t task_count,
+                    const Types&... args) {
+    for (size_t task_idx = 0; task_idx < task_count; ++task_idx) {
+      Enqueue(func, args...);
+    }
+  }
+
+  size_t WorkerCount() const noexcept { return m_worker_count; }
+
+  const ThreadPoolSettings& GetSettings() const noexcept { return m_settings; }
+
+#ifdef THREAD_POOL_METRICS
+  metrics::PoolSnapshot GetMetrics() const {
+    metrics::PoolSnapshot snapshot;
+    {
+      std::lock_guard lock(m_workers_mtx);
+      snapshot = m_retired_metrics;
+      for (const auto& worker : m_workers) {
+        worker.metrics.AccumulateTo(snapshot);
+        snapshot.workers.push_back(worker.metrics.Snapshot(worker.idx));
+      }
+    }
+    snapshot.worker_count = WorkerCount();
+    snapshot.idle_workers = m_idle_workers.load(std::memory_order_relaxed);
+    snapshot.tasks_submitted =
+        m_tasks_submitted.load(std::memory_order_relaxed);
+    snapshot.tasks_rejected = m_tasks_rejected.load(std::memory_order_relaxed);
+    snapshot.tasks_dropped = m_tasks_dropped.load(std::memory_order_relaxed);
+    snapshot.tasks_cancelled =
+        m_tasks_cancelled.load(std::memory_order_relaxed);
+    snapshot.tasks_executed = snapshot.execution_time.count;
+    const uint64_t tasks_started{snapshot.queue_latency.count +
+                                 snapshot.tasks_dropped +
+                                 snapshot.tasks_cancelled};
+    snapshot.queue_depth = static_cast<size_t>(
+        snapshot.tasks_submitted > tasks_started
+            ? snapshot.tasks_submitted - tasks_started
+            : 0);
+    return snapshot;
+  }
+#endif
+
+ private:
+  static ThreadPoolSettings fixed_size(size_t worker_count) {
+    ThreadPoolSettings settings;
+    settings.min_workers = worker_count;
+    settings.max_workers = worker_count;
+    return settings;
+  }
+
+  static ThreadPoolSettings normalize(ThreadPoolSettings settings) {
+    settings.min_workers = std::max(settings.min_workers, size_t{1});
+    settings.max_workers = std::max(settings.max_workers, settings.min_workers);
+    return settings;
+  }
+
+  static clock_t::rep now() noexcept {
+    return clock_t::now().time_since_epoch().count();
+  }
+
+  bool scalable() const noexcept {
+    return m_settings.min_workers < m_settings.max_workers;
+  }
+
+  template <class Function, class... Types>
+  auto schedule(Function&& func, Types&&... args) {
     static_assert(std::is_invocable_v<Function, Types...>,
                   "Impossible to invoke a callable with passed arguments");
     auto task_guard{
-        async::MakeTaskHolder<async::PackagedTask, Function, Types...> >
-        (std::forward<Function>(func), std::forward<Types>(args)...)};
+        async::MakeUniqueTask<async::PackagedTask, Function, Types...>(
+            std::forward<Function>(func), std::forward<Types>(args)...)};
     /**********************************************************************************************************
      future        -  
          : < 1>: <
@@ -262,57 +649,373 @@ class ThreadPool {
     > [future object] was the last reference to the shared state
     **********************************************************************************************************/
     auto future{task_guard->GetFuture()};
-    if (!m_tasks.push(task_guard.get())) {
-      throw runtime_error("Can't push task into queue");
-    }
-    m_controller.NotifyOne();
-    task_guard.release();
+    push(std::move(task_guard));
     return future;
   }
 
   template <class Function, class... Types>
-  void Enqueue(Function&& func, Types&&... args) {
+  auto try_schedule(Function&& func, Types&&... args)
+      -> std::optional<decltype(
+          async::MakeUniqueTask<async::PackagedTask, Function, Types...>(
+              std::forward<Function>(func), std::forward<Types>(args)...)
+              ->GetFuture())> {
     static_assert(std::is_invocable_v<Function, Types...>,
                   "Impossible to invoke a callable with passed arguments");
     auto task_guard{
-        async::MakeTaskHolder<async::DetachedTask, Function, Types...>(
+        async::MakeUniqueTask<async::PackagedTask, Function, Types...>(
             std::forward<Function>(func), std::forward<Types>(args)...)};
-    if (!m_tasks.push(task_guard.get())) {
-      throw runtime_error("Can't push task into queue");
+    auto future{task_guard->GetFuture()};
+    if (async::task_holder task{std::move(task_guard)}; !try_push(task)) {
+      task_rejected();
+      return std::nullopt;
     }
-    m_controller.NotifyOne();
-    task_guard.release();
+    return future;
   }
 
-  template <class Function, class... Types>
-  void EnqueueMulti(const Function& func,
-                    size_t task_count,
-                    const Types&... args) {
-    for (size_t task_idx = 0; task_idx < task_count; ++task_idx) {
-      Enqueue(func, args...);
+  void push(async::task_holder task) {
+    if (try_push(task)) {
+      return;
+    }
+    throw_if_shut_down();
+    if (!m_tasks.Bounded()) {
+      throw std::runtime_error("Can't push task into queue");
+    }
+    switch (m_settings.overflow_policy) {
+      case OverflowPolicy::Block:
+        push_when_available(task);
+        break;
+      case OverflowPolicy::Reject:
+        task_rejected();
+        throw QueueOverflow{};
+      case OverflowPolicy::CallerRuns:
+        task->Process();
+        break;
+      case OverflowPolicy::DropOldest:
+        push_dropping_oldest(task);
+        break;
     }
   }
 
-  size_t WorkerCount() const noexcept { return m_workers.size(); }
+  bool try_push(async::task_holder& task) {  // Releases the task on success
+    if (!accepting()) {
+      return false;
+    }
+#ifdef THREAD_POOL_METRICS
+    task->MarkEnqueued();
+#endif
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    if (!m_tasks.TryPush(task.get())) {
+      task_finished();
+      return false;
+    }
+    task.release();
+#ifdef THREAD_POOL_METRICS
+    m_tasks_submitted.fetch_add(1, std::memory_order_relaxed);
+#endif
+    std::atomic_thread_fence(
+        std::memory_order_seq_cst);  // Pairs with the one in wait_for_task()
+    if (m_idle_workers.load(std::memory_order_relaxed) > 0) {
+      m_controller.NotifyOne();
+    }
+    return true;
+  }
 
- private:
-  void execute() {
+  void push_when_available(async::task_holder& task) {
+    while (!try_push(task)) {
+      throw_if_shut_down();
+      m_blocked_producers.fetch_add(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      m_space_controller.Wait(
+          [this] { return !m_tasks.Full() || !accepting(); });
+      m_blocked_producers.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  void push_dropping_oldest(async::task_holder& task) {
+    while (!try_push(task)) {
+      throw_if_shut_down();
+      if (async::ITask* oldest{nullptr}; m_tasks.TryPop(oldest)) {
+        discard(oldest);
+#ifdef THREAD_POOL_METRICS
+        m_tasks_dropped.fetch_add(1, std::memory_order_relaxed);
+#endif
+      }
+    }
+  }
+
+  void discard(async::ITask* task) noexcept {
+    std::unique_ptr<async::ITask> task_guard(task);
+    task_guard->Cancel();
+    task_finished();
+  }
+
+  void discard_queued() noexcept {
+    for (async::ITask* task{nullptr}; m_tasks.TryPop(task);) {
+      wake_producer();
+      discard(task);
+#ifdef THREAD_POOL_METRICS
+      m_tasks_cancelled.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+  }
+
+  void task_finished() {  // Queued task is executed or discarded
+    if (m_pending.fetch_sub(1, std::memory_order_relaxed) == 1) {
+      std::atomic_thread_fence(
+          std::memory_order_seq_cst);  // Pairs with the one in WaitIdle()
+      if (m_idle_waiters.load(std::memory_order_relaxed) > 0) {
+        m_idle_controller.NotifyAll();
+      }
+    }
+  }
+
+  bool accepting() const noexcept {
+    return m_accepting.load(std::memory_order_acquire);
+  }
+
+  void throw_if_shut_down() {
+    if (!accepting()) {
+      task_rejected();
+      throw std::runtime_error("ThreadPool is shut down");
+    }
+  }
+
+  void task_rejected() noexcept {
+#ifdef THREAD_POOL_METRICS
+    m_tasks_rejected.fetch_add(1, std::memory_order_relaxed);
+#endif
+  }
+
+  void wake_producer() {
+    if (m_tasks.Bounded()) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (m_blocked_producers.load(std::memory_order_relaxed) > 0) {
+        m_space_controller.NotifyOne();
+      }
+    }
+  }
+
+  void execute(Worker& worker) {
+    current_pool() = this;
+    configure_worker(worker.idx);
     for (;;) {
       async::ITask* task{nullptr};
-      if (m_tasks.pop(task)) {
-        std::unique_ptr<async::ITask> task_guard(task);
-        task_guard->Process();
+      if (m_tasks.TryPop(task)) {
+        m_last_dequeue.store(now(), std::memory_order_relaxed);
+        wake_producer();
+        {
+          std::unique_ptr<async::ITask> task_guard(task);
+          process(worker, *task_guard);
+        }
+        task_finished();
       } else if (m_controller.Stopped()) {
         break;
+      } else if (!wait_for_task() && try_retire()) {
+        break;
+      }
+    }
+    worker.finished = true;
+  }
+
+  void process([[maybe_unused]] Worker& worker, async::ITask& task) {
+#ifdef THREAD_POOL_METRICS
+    const auto started{metrics::clock_t::now()};
+    worker.metrics.TaskStarted(started - task.EnqueuedAt());
+    const bool succeeded{task.Process()};
+    worker.metrics.TaskFinished(metrics::clock_t::now() - started, succeeded);
+#else
+    task.Process();
+#endif
+  }
+
+  bool wait_for_task() {  // Returns false on idle timeout
+    m_idle_workers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto task_available{
+        [this] { return !m_tasks.Empty() || m_controller.Stopped(); }};
+    bool woken_up{true};
+    if (scalable()) {
+      woken_up = m_controller.WaitFor(m_settings.idle_timeout, task_available);
+    } else {
+      m_controller.Wait(task_available);
+    }
+    m_idle_workers.fetch_sub(1, std::memory_order_relaxed);
+    return woken_up;
+  }
+
+  bool try_retire() noexcept {
+    size_t worker_count{m_worker_count.load()};
+    do {
+      if (worker_count <= m_settings.min_workers) {
+        return false;
+      }
+    } while (
+        !m_worker_count.compare_exchange_weak(worker_count, worker_count - 1));
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!m_tasks.Empty()) {  // A task was pushed after the timeout
+      ++m_worker_count;
+      return false;
+    }
+    return true;
+  }
+
+  void configure_worker(size_t worker_idx) const {
+    if (!m_settings.thread_name.empty()) {
+      this_thread::SetName(m_settings.thread_name + "-" +
+                           std::to_string(worker_idx));
+    }
+    switch (m_settings.affinity) {
+      case WorkerAffinity::Core:
+        this_thread::BindToCore(
+            worker_idx % std::max(std::thread::hardware_concurrency(), 1u));
+        break;
+      case WorkerAffinity::NumaNode:
+        this_thread::BindToNumaNode(worker_idx % NumaNodeCount());
+        break;
+      default:
+        break;
+    }
+  }
+
+  void supervise() {
+    while (!m_supervisor_controller.WaitFor(
+        m_settings.scale_up_latency,
+        [this] { return m_supervisor_controller.Stopped(); })) {
+      if (queue_stalled() && reserve_worker()) {
+        try {
+          start_worker();
+        } catch (const std::system_error&) {  // OS thread limit is reached,
+        }                                     // retry on the next tick
+      }
+    }
+  }
+
+  bool queue_stalled() const noexcept {
+    const auto stall_duration{
+        clock_t::duration{now() - m_last_dequeue.load(std::memory_order_relaxed)}};
+    return m_idle_workers.load(std::memory_order_relaxed) == 0 &&
+           !m_tasks.Empty() && stall_duration > m_settings.scale_up_latency;
+  }
+
+  bool reserve_worker() noexcept {
+    size_t worker_count{m_worker_count.load()};
+    do {
+      if (worker_count >= m_settings.max_workers) {
+        return false;
+      }
+    } while (
+        !m_worker_count.compare_exchange_weak(worker_count, worker_count + 1));
+    return true;
+  }
+
+  void start_worker() {  // Reservation is released if the thread can't start
+    std::lock_guard lock(m_workers_mtx);
+    try {
+      release_finished_workers();
+      auto& worker{m_workers.emplace_back(first_free_worker_idx())};
+      try {
+        worker.thread = std::thread(&ThreadPool::execute, this, std::ref(worker));
+      } catch (...) {
+        m_workers.pop_back();
+        throw;
+      }
+    } catch (...) {
+      --m_worker_count;
+      throw;
+    }
+    m_last_dequeue.store(now(), std::memory_order_relaxed);
+  }
+
+  void release_finished_workers() {
+    for (auto it = m_workers.begin(); it != m_workers.end();) {
+      if (it->finished) {
+        it->thread.join();
+#ifdef THREAD_POOL_METRICS
+        it->metrics.AccumulateTo(m_retired_metrics);
+#endif
+        it = m_workers.erase(it);
       } else {
-        m_controller.Wait();
+        ++it;
       }
     }
   }
 
+  size_t first_free_worker_idx() const {
+    size_t worker_idx{0};
+    while (std::any_of(m_workers.begin(), m_workers.end(),
+                       [worker_idx](const Worker& worker) {
+                         return worker.idx == worker_idx;
+                       })) {
+      ++worker_idx;
+    }
+    return worker_idx;
+  }
+
+  void shutdown(ShutdownMode mode) noexcept {
+    std::lock_guard lock(m_shutdown_mtx);
+    if (!m_accepting.exchange(false)) {
+      return;
+    }
+    if (mode == ShutdownMode::Cancel) {
+      m_cancellation.Cancel();
+      discard_queued();
+    }
+    stop();
+    discard_queued();  // Pushed after the workers had seen an empty queue
+  }
+
+  static const ThreadPool*& current_pool() noexcept {  // Of this worker
+    thread_local const ThreadPool* pool{nullptr};
+    return pool;
+  }
+
+  void throw_if_worker_thread(const char* message) const {
+    if (current_pool() == this) {
+      throw std::logic_error(message);
+    }
+  }
+
+  void stop() noexcept {
+    if (m_supervisor.joinable()) {
+      m_supervisor_controller.Stop();
+      m_supervisor_controller.NotifyAll();
+      m_supervisor.join();
+    }
+    m_controller.Stop();
+    m_controller.NotifyAll();
+    m_space_controller.NotifyAll();
+    for (auto& worker : m_workers) {  // Nobody else adds or removes workers
+      worker.thread.join();           // now; running tasks may still lock
+    }                                 // m_workers_mtx, e.g. in GetMetrics()
+    std::lock_guard lock(m_workers_mtx);
+#ifdef THREAD_POOL_METRICS
+    for (const auto& worker : m_workers) {
+      worker.metrics.AccumulateTo(m_retired_metrics);
+    }
+#endif
+    m_workers.clear();
+    m_worker_count = 0;
+  }
+
  private:
-  std::vector<std::thread> m_workers;
-  lockfree_queue m_tasks;
-  ThreadController m_controller;
+  const ThreadPoolSettings m_settings;
+  details::TaskQueue m_tasks;
+  ThreadController m_controller, m_space_controller, m_idle_controller;
+  std::atomic<size_t> m_worker_count{0}, m_idle_workers{0},
+      m_blocked_producers{0}, m_idle_waiters{0},
+      m_pending{0};  // Queued and running tasks
+  std::atomic<bool> m_accepting{true};
+  std::mutex m_shutdown_mtx;
+  CancellationSource m_cancellation;
+  std::atomic<clock_t::rep> m_last_dequeue;
+  mutable std::mutex m_workers_mtx;
+  std::list<Worker> m_workers;  // Stable addresses: threads refer to them
+#ifdef THREAD_POOL_METRICS
+  std::atomic<uint64_t> m_tasks_submitted{0}, m_tasks_rejected{0},
+      m_tasks_dropped{0}, m_tasks_cancelled{0};
+  metrics::PoolSnapshot m_retired_metrics;  // Guarded by m_workers_mtx
+#endif
+  ThreadController m_supervisor_controller;
+  std::thread m_supervisor;
 };
 }  // namespace utility::concurrency
@@ -0,0 +1,201 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*********************************************************************
+ThreadPool collects metrics only if THREAD_POOL_METRICS is defined for
+the whole project: it changes the layout of async::ITask and
+ThreadPool, and without it neither a clock is read nor a counter is
+touched on the hot path. Counters of a worker are written by that worker
+only (relaxed load + store instead of RMW) and merged on GetMetrics()
+*********************************************************************/
+namespace utility::concurrency::metrics {
+using clock_t = std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+
+namespace details {
+inline unsigned highest_bit(uint64_t value) noexcept {  // value != 0
+#if defined(_MSC_VER)
+  unsigned long bit_idx;
+  _BitScanReverse64(&bit_idx, value);
+  return static_cast<unsigned>(bit_idx);
+#else
+  return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+inline void increase(std::atomic<uint64_t>& counter, uint64_t value) noexcept {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);  // Single writer
+}
+}  // namespace details
+
+/*********************************************************************
+Log-linear (HDR-style) buckets: values below 2^SUB_BUCKET_BITS are exact,
+every next power of two is split into 2^SUB_BUCKET_BITS equal parts, so
+relative error doesn't exceed 1/8 on the whole range of 1 ns..~39 hours
+*********************************************************************/
+struct HistogramLayout {
+  static constexpr unsigned SUB_BUCKET_BITS{3}, MAX_EXPONENT{47};
+  static constexpr uint64_t SUB_BUCKET_COUNT{uint64_t{1} << SUB_BUCKET_BITS};
+  static constexpr size_t BUCKET_COUNT{
+      (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT};
+
+  static size_t BucketOf(uint64_t value) noexcept {
+    if (value < SUB_BUCKET_COUNT) {
+      return static_cast<size_t>(value);
+    }
+    const unsigned exponent{
+        std::min(details::highest_bit(value), MAX_EXPONENT)};
+    const uint64_t sub_bucket{
+        std::min(value >> (exponent - SUB_BUCKET_BITS),
+                 2 * SUB_BUCKET_COUNT - 1) -
+        SUB_BUCKET_COUNT};
+    return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) *
+                                   SUB_BUCKET_COUNT +
+                               sub_bucket);
+  }
+
+  static uint64_t HighestValueOf(size_t bucket_idx) noexcept {
+    if (bucket_idx < SUB_BUCKET_COUNT) {
+      return bucket_idx;
+    }
+    const unsigned exponent{static_cast<unsigned>(
+        bucket_idx / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1)};
+    const uint64_t sub_bucket{bucket_idx % SUB_BUCKET_COUNT},
+        step{uint64_t{1} << (exponent - SUB_BUCKET_BITS)};
+    return (SUB_BUCKET_COUNT + sub_bucket + 1) * step - 1;
+  }
+};
+
+struct HistogramSnapshot {
+  std::vector<uint64_t> buckets =
+      std::vector<uint64_t>(HistogramLayout::BUCKET_COUNT);
+  uint64_t count{0};
+  nanoseconds total{0}, max{0};
+
+  nanoseconds Mean() const noexcept {
+    return count ? nanoseconds{total.count() /
+                               static_cast<nanoseconds::rep>(count)}
+                 : nanoseconds{0};
+  }
+
+  nanoseconds Percentile(double percent) const noexcept {  // 0..100
+    const auto rank{static_cast<uint64_t>(
+        std::max(1.0, static_cast<double>(count) * percent / 100.0 + 0.5))};
+    uint64_t seen{0};
+    for (size_t bucket_idx = 0; bucket_idx < buckets.size(); ++bucket_idx) {
+      if (seen += buckets[bucket_idx]; seen >= rank) {
+        return std::min(
+            nanoseconds{HistogramLayout::HighestValueOf(bucket_idx)}, max);
+      }
+    }
+    return max;
+  }
+
+  HistogramSnapshot& operator+=(const HistogramSnapshot& other) {
+    for (size_t bucket_idx = 0; bucket_idx < buckets.size(); ++bucket_idx) {
+      buckets[bucket_idx] += other.buckets[bucket_idx];
+    }
+    count += other.count;
+    total += other.total;
+    max = std::max(max, other.max);
+    return *this;
+  }
+};
+
+class LatencyHistogram {
+ public:
+  void Record(nanoseconds latency) noexcept {
+    const auto value{static_cast<uint64_t>(
+        std::max(latency.count(), nanoseconds::rep{0}))};
+    details::increase(m_buckets[HistogramLayout::BucketOf(value)], 1);
+    details::increase(m_count, 1);
+    details::increase(m_total, value);
+    if (value > m_max.load(std::memory_order_relaxed)) {
+      m_max.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  void AccumulateTo(HistogramSnapshot& snapshot) const {
+    for (size_t bucket_idx = 0; bucket_idx < m_buckets.size(); ++bucket_idx) {
+      snapshot.buckets[bucket_idx] +=
+          m_buckets[bucket_idx].load(std::memory_order_relaxed);
+    }
+    snapshot.count += m_count.load(std::memory_order_relaxed);
+    snapshot.total += nanoseconds{m_total.load(std::memory_order_relaxed)};
+    snapshot.max = std::max(
+        snapshot.max, nanoseconds{m_max.load(std::memory_order_relaxed)});
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, HistogramLayout::BUCKET_COUNT> m_buckets{};
+  std::atomic<uint64_t> m_count{0}, m_total{0}, m_max{0};
+};
+
+struct WorkerSnapshot {
+  size_t idx;
+  uint64_t tasks_executed, tasks_failed;
+  nanoseconds busy_time, lifetime;
+
+  double Utilization() const noexcept {
+    return lifetime.count() ? static_cast<double>(busy_time.count()) /
+                                  static_cast<double>(lifetime.count())
+                            : 0.0;
+  }
+};
+
+struct PoolSnapshot {
+  size_t worker_count{0}, idle_workers{0},
+      queue_depth{0};  // Approximate: the queue isn't frozen while copying
+  uint64_t tasks_submitted{0}, tasks_executed{0}, tasks_failed{0},
+      tasks_rejected{0},  // Full bounded queue, incl. failed Try* calls
+      tasks_dropped{0},   // OverflowPolicy::DropOldest victims
+      tasks_cancelled{0};  // Discarded by ThreadPool::Shutdown()
+  HistogramSnapshot queue_latency,  // Enqueue-to-start
+      execution_time;
+  std::vector<WorkerSnapshot> workers;  // Alive workers only
+};
+
+class WorkerMetrics {
+ public:
+  void TaskStarted(nanoseconds queue_latency) noexcept {
+    m_queue_latency.Record(queue_latency);
+  }
+
+  void TaskFinished(nanoseconds execution_time, bool succeeded) noexcept {
+    m_execution_time.Record(execution_time);
+    if (!succeeded) {
+      details::increase(m_tasks_failed, 1);
+    }
+  }
+
+  void AccumulateTo(PoolSnapshot& snapshot) const {
+    m_queue_latency.AccumulateTo(snapshot.queue_latency);
+    m_execution_time.AccumulateTo(snapshot.execution_time);
+    snapshot.tasks_failed += m_tasks_failed.load(std::memory_order_relaxed);
+  }
+
+  WorkerSnapshot Snapshot(size_t worker_idx) const {
+    HistogramSnapshot execution_time;
+    m_execution_time.AccumulateTo(execution_time);
+    return {worker_idx, execution_time.count,
+            m_tasks_failed.load(std::memory_order_relaxed),
+            execution_time.total, clock_t::now() - m_started};
+  }
+
+ private:
+  const clock_t::time_point m_started{clock_t::now()};
+  std::atomic<uint64_t> m_tasks_failed{0};
+  LatencyHistogram m_queue_latency, m_execution_time;
+};
+}  // namespace utility::concurrency::metrics
@@ -0,0 +1,137 @@
+#include "thread_utils.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace utility::concurrency {
+namespace {
+#if defined(__linux__)
+constexpr size_t MAX_LINUX_THREAD_NAME{15};  // Without null terminator
+
+string numa_node_path(size_t node_idx) {
+  return "/sys/devices/system/node/node" + to_string(node_idx) + "/cpulist";
+}
+
+bool read_cpu_list(size_t node_idx, cpu_set_t& cpu_set) {  // Format: 0-3,8,10-11
+  ifstream cpu_list(numa_node_path(node_idx));
+  if (!cpu_list) {
+    return false;
+  }
+  CPU_ZERO(&cpu_set);
+  bool any_cpu{false};
+  string range;
+  while (getline(cpu_list, range, ',')) {
+    size_t first, last;
+    char dash;
+    istringstream parser(range);
+    if (!(parser >> first)) {
+      continue;
+    }
+    if (!(parser >> dash >> last)) {
+      last = first;
+    }
+    for (size_t cpu_idx = first; cpu_idx <= last && cpu_idx < CPU_SETSIZE;
+         ++cpu_idx) {
+      CPU_SET(cpu_idx, &cpu_set);
+      any_cpu = true;
+    }
+  }
+  return any_cpu;
+}
+#endif
+}  // namespace
+
+size_t NumaNodeCount() {
+#if defined(_WIN32)
+  ULONG highest_node{0};
+  if (!GetNumaHighestNodeNumber(&highest_node)) {
+    return 1;
+  }
+  return static_cast<size_t>(highest_node) + 1;
+#elif defined(__linux__)
+  size_t node_count{0};
+  while (ifstream(numa_node_path(node_count))) {
+    ++node_count;
+  }
+  return max(node_count, size_t{1});
+#else
+  return 1;
+#endif
+}
+
+namespace this_thread {
+bool SetName(string_view name) {
+#if defined(_WIN32)
+  wstring wide_name(name.begin(), name.end());  // ASCII names are expected
+  return SUCCEEDED(SetThreadDescription(GetCurrentThread(), wide_name.c_str()));
+#elif defined(__linux__)
+  string short_name{name.substr(0, MAX_LINUX_THREAD_NAME)};
+  return pthread_setname_np(pthread_self(), short_name.c_str()) == 0;
+#elif defined(__APPLE__)
+  string thread_name{name};
+  return pthread_setname_np(thread_name.c_str()) == 0;
+#else
+  return false;
+#endif
+}
+
+bool BindToCore(size_t core_idx) {
+#if defined(_WIN32)
+  constexpr size_t GROUP_SIZE{sizeof(KAFFINITY) * 8};
+  GROUP_AFFINITY affinity{};
+  affinity.Group = static_cast<WORD>(core_idx / GROUP_SIZE);
+  affinity.Mask = KAFFINITY{1} << (core_idx % GROUP_SIZE);
+  return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+#elif defined(__linux__)
+  if (core_idx >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(core_idx, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  return false;
+#endif
+}
+
+bool BindToNumaNode(size_t node_idx) {
+#if defined(_WIN32)
+  GROUP_AFFINITY affinity{};
+  if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node_idx), &affinity)) {
+    return false;
+  }
+  return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+#elif defined(__linux__)
+  cpu_set_t cpu_set;
+  if (!read_cpu_list(node_idx, cpu_set)) {
+    return false;
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  return false;
+#endif
+}
+}  // namespace this_thread
+}  // namespace utility::concurrency
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+namespace utility::concurrency {
+size_t NumaNodeCount();  // 1 if NUMA topology is unavailable
+
+namespace this_thread {
+// All functions return false if the platform doesn't support the operation
+// or the OS refused it: naming and pinning are best-effort hints
+bool SetName(std::string_view name);  // Truncated to 15 characters on Linux
+bool BindToCore(size_t core_idx);
+bool BindToNumaNode(size_t node_idx);
+}  // namespace this_thread
+}  // namespace utility::concurrency